@@ -0,0 +1,39 @@
+#include "AllocCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+
+std::atomic<long long> ALLOC_COUNT(0);
+
+void* counted_alloc(std::size_t size)
+{
+	++ALLOC_COUNT;
+	void* p = std::malloc(size ? size : 1);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+}
+
+long long alloc_count()
+{
+	return ALLOC_COUNT.load();
+}
+
+void* operator new(std::size_t size) { return counted_alloc(size); }
+void* operator new[](std::size_t size) { return counted_alloc(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { ++ALLOC_COUNT; return std::malloc(size ? size : 1); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { ++ALLOC_COUNT; return std::malloc(size ? size : 1); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
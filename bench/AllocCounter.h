@@ -0,0 +1,5 @@
+#pragma once
+
+// Number of operator new calls made so far by any thread. Linking
+// AllocCounter.cpp replaces the global allocation functions.
+long long alloc_count();
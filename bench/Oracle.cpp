@@ -0,0 +1,346 @@
+#include "Oracle.h"
+
+#include <algorithm>
+
+namespace oracle
+{
+
+std::vector<real> open_knots(int npts, int c)
+{
+	std::vector<real> x(npts + c);
+	for (int i = 0; i < npts + c; ++i)
+	{
+		if (i < c) {
+			x[i] = 0;
+		} else if (i <= npts) {
+			x[i] = i - c + 1;
+		} else {
+			x[i] = npts - c + 1;
+		}
+	}
+	return x;
+}
+
+std::vector<real> periodic_knots(int npts, int c)
+{
+	std::vector<real> x(npts + c);
+	for (int i = 0; i < npts + c; ++i) {
+		x[i] = i;
+	}
+	return x;
+}
+
+void basis(int c, real t, int npts, const std::vector<real>& x, std::vector<real>& n)
+{
+	const int nplusc = npts + c;
+	std::vector<real> temp(nplusc - 1, 0);
+
+	if (t >= x[npts])
+	{
+		for (int i = npts - 1; i >= 0; --i) {
+			if (x[i] < x[i + 1]) {
+				temp[i] = 1;
+				break;
+			}
+		}
+	}
+	else
+	{
+		for (int i = 0; i < nplusc - 1; ++i) {
+			temp[i] = x[i] <= t && t < x[i + 1] ? 1 : 0;
+		}
+	}
+
+	for (int k = 2; k <= c; ++k)
+	{
+		for (int i = 0; i < nplusc - k; ++i)
+		{
+			const real dl = x[i + k - 1] - x[i];
+			const real dr = x[i + k] - x[i + 1];
+			const real d = dl != 0 ? (t - x[i]) * temp[i] / dl : 0;
+			const real e = dr != 0 ? (x[i + k] - t) * temp[i + 1] / dr : 0;
+			temp[i] = d + e;
+		}
+	}
+
+	n.assign(temp.begin(), temp.begin() + npts);
+}
+
+void basis_derivs(int c, real t, int npts, const std::vector<real>& x, int nd, std::vector<real>& n)
+{
+	std::vector<real> values;
+	basis(c, t, npts, x, values);
+	n.assign((nd + 1) * npts, 0);
+	std::copy(values.begin(), values.end(), n.begin());
+	if (nd == 0 || c == 1) {
+		return;
+	}
+
+	// N(d)[i, c] = (c - 1) (N(d - 1)[i, c - 1] / (x[i + c - 1] - x[i])
+	//                       - N(d - 1)[i + 1, c - 1] / (x[i + c] - x[i + 1]))
+	std::vector<real> lower;
+	basis_derivs(c - 1, t, npts + 1, x, nd - 1, lower);
+	for (int d = 1; d <= nd; ++d)
+	{
+		const real* m = &lower[(d - 1) * (npts + 1)];
+		for (int i = 0; i < npts; ++i)
+		{
+			const real dl = x[i + c - 1] - x[i];
+			const real dr = x[i + c] - x[i + 1];
+			const real a = dl != 0 ? m[i] / dl : 0;
+			const real b = dr != 0 ? m[i + 1] / dr : 0;
+			n[d * npts + i] = (c - 1) * (a - b);
+		}
+	}
+}
+
+std::vector<real> bspline(int c, int npts, const std::vector<real>& x, const CurveNet& b,
+	                      const CurveWeights& h, const std::vector<real>& params, int dim)
+{
+	std::vector<real> out(params.size() * dim), n;
+	for (std::size_t s = 0; s < params.size(); ++s)
+	{
+		basis(c, params[s], npts, x, n);
+		real sum = 0;
+		for (int i = 0; i < npts; ++i)
+		{
+			const real w = h ? n[i] * h(i) : n[i];
+			for (int d = 0; d < dim; ++d) {
+				out[s * dim + d] += w * b(i, d);
+			}
+			sum += w;
+		}
+		for (int d = 0; d < dim && h; ++d) {
+			out[s * dim + d] /= sum;
+		}
+	}
+	return out;
+}
+
+std::vector<real> bezier(int npts, const CurveNet& b, const std::vector<real>& params, int dim, int nd)
+{
+	// control points of the nd-th hodograph, scaled by n!/(n-nd)!
+	const int n = npts - 1 - nd;
+	std::vector<real> ctl(npts * dim);
+	for (int i = 0; i < npts; ++i) {
+		for (int d = 0; d < dim; ++d) {
+			ctl[i * dim + d] = b(i, d);
+		}
+	}
+	real scale = 1;
+	for (int r = 0; r < nd; ++r)
+	{
+		scale *= npts - 1 - r;
+		for (int i = 0; i < npts - 1 - r; ++i) {
+			for (int d = 0; d < dim; ++d) {
+				ctl[i * dim + d] = ctl[(i + 1) * dim + d] - ctl[i * dim + d];
+			}
+		}
+	}
+
+	std::vector<real> out(params.size() * dim, 0), tmp;
+	if (n < 0) {
+		return out;
+	}
+	for (std::size_t s = 0; s < params.size(); ++s)
+	{
+		const real t = params[s];
+		tmp.assign(ctl.begin(), ctl.begin() + (n + 1) * dim);
+		for (int r = 1; r <= n; ++r) {
+			for (int i = 0; i <= n - r; ++i) {
+				for (int d = 0; d < dim; ++d) {
+					tmp[i * dim + d] = (1 - t) * tmp[i * dim + d] + t * tmp[(i + 1) * dim + d];
+				}
+			}
+		}
+		for (int d = 0; d < dim; ++d) {
+			out[s * dim + d] = scale * tmp[d];
+		}
+	}
+	return out;
+}
+
+std::vector<real> surface(int k, int l, int npts, int mpts, const std::vector<real>& x,
+	                      const std::vector<real>& y, const SurfaceNet& b, const SurfaceWeights& h,
+	                      const std::vector<real>& uparams, const std::vector<real>& wparams)
+{
+	const int nw = static_cast<int>(wparams.size());
+	std::vector<std::vector<real>> mbasis(nw);
+	for (int s = 0; s < nw; ++s) {
+		basis(l, wparams[s], mpts, y, mbasis[s]);
+	}
+
+	std::vector<real> out(uparams.size() * nw * 3, 0), nbasis;
+	for (std::size_t su = 0; su < uparams.size(); ++su)
+	{
+		basis(k, uparams[su], npts, x, nbasis);
+		for (int sw = 0; sw < nw; ++sw)
+		{
+			real* p = &out[(su * nw + sw) * 3];
+			real sum = 0;
+			for (int i = 0; i < npts; ++i)
+			{
+				if (nbasis[i] == 0) {
+					continue;
+				}
+				for (int j = 0; j < mpts; ++j)
+				{
+					real w = nbasis[i] * mbasis[sw][j];
+					if (h) {
+						w *= h(i, j);
+					}
+					for (int c = 0; c < 3; ++c) {
+						p[c] += w * b(i, j, c);
+					}
+					sum += w;
+				}
+			}
+			for (int c = 0; c < 3 && h; ++c) {
+				p[c] /= sum;
+			}
+		}
+	}
+	return out;
+}
+
+std::vector<real> bezsurf(int npts, int mpts, const SurfaceNet& b,
+	                      const std::vector<real>& uparams, const std::vector<real>& wparams)
+{
+	// a Bezier patch is the B-spline patch of full order on open knots
+	return surface(npts, mpts, npts, mpts, open_knots(npts, npts), open_knots(mpts, mpts),
+		b, SurfaceWeights(), uparams, wparams);
+}
+
+namespace
+{
+
+real binomial(int n, int k)
+{
+	real r = 1;
+	for (int i = 1; i <= k; ++i) {
+		r = r * (n - k + i) / i;
+	}
+	return r;
+}
+
+}
+
+std::vector<real> bspline_derivs(int c, int npts, const std::vector<real>& x, const CurveNet& b,
+	                             const CurveWeights& h, const std::vector<real>& params, int nd)
+{
+	const int d1 = nd + 1;
+	std::vector<real> out(params.size() * d1 * 3, 0), n;
+	std::vector<real> a(d1 * 3), w(d1);
+	for (std::size_t s = 0; s < params.size(); ++s)
+	{
+		basis_derivs(c, params[s], npts, x, nd, n);
+		std::fill(a.begin(), a.end(), 0);
+		std::fill(w.begin(), w.end(), 0);
+		for (int d = 0; d <= nd; ++d)
+		{
+			for (int i = 0; i < npts; ++i)
+			{
+				const real v = h ? n[d * npts + i] * h(i) : n[d * npts + i];
+				for (int e = 0; e < 3; ++e) {
+					a[d * 3 + e] += v * b(i, e);
+				}
+				w[d] += v;
+			}
+		}
+
+		// C(d) = (A(d) - sum_i binomial(d, i) w(i) C(d - i)) / w
+		real* p = &out[s * d1 * 3];
+		for (int d = 0; d <= nd; ++d)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				if (!h) {
+					p[d * 3 + e] = a[d * 3 + e];
+					continue;
+				}
+				real v = a[d * 3 + e];
+				for (int i = 1; i <= d; ++i) {
+					v -= binomial(d, i) * w[i] * p[(d - i) * 3 + e];
+				}
+				p[d * 3 + e] = v / w[0];
+			}
+		}
+	}
+	return out;
+}
+
+std::vector<real> surface_derivs(int k, int l, int npts, int mpts, const std::vector<real>& x,
+	                             const std::vector<real>& y, const SurfaceNet& b, const SurfaceWeights& h,
+	                             const std::vector<real>& uparams, const std::vector<real>& wparams, int nd)
+{
+	const int d1 = nd + 1;
+	const int nw = static_cast<int>(wparams.size());
+	std::vector<std::vector<real>> mbasis(nw);
+	for (int s = 0; s < nw; ++s) {
+		basis_derivs(l, wparams[s], mpts, y, nd, mbasis[s]);
+	}
+
+	std::vector<real> out(uparams.size() * nw * d1 * d1 * 3, 0), nbasis;
+	std::vector<real> a(d1 * d1 * 3), w(d1 * d1);
+	for (std::size_t su = 0; su < uparams.size(); ++su)
+	{
+		basis_derivs(k, uparams[su], npts, x, nd, nbasis);
+		for (int sw = 0; sw < nw; ++sw)
+		{
+			const std::vector<real>& m = mbasis[sw];
+			std::fill(a.begin(), a.end(), 0);
+			std::fill(w.begin(), w.end(), 0);
+			for (int i = 0; i < npts; ++i)
+			{
+				for (int j = 0; j < mpts; ++j)
+				{
+					const real hij = h ? h(i, j) : 1;
+					for (int da = 0; da <= nd; ++da)
+					{
+						for (int db = 0; db <= nd; ++db)
+						{
+							const real v = nbasis[da * npts + i] * m[db * mpts + j] * hij;
+							if (v == 0) {
+								continue;
+							}
+							for (int e = 0; e < 3; ++e) {
+								a[(da * d1 + db) * 3 + e] += v * b(i, j, e);
+							}
+							w[da * d1 + db] += v;
+						}
+					}
+				}
+			}
+
+			// S(a, b) = (A(a, b) - sum binomial(a, i) binomial(b, j) w(i, j)
+			//           S(a - i, b - j)) / w over (i, j) != (0, 0)
+			real* p = &out[(su * nw + sw) * d1 * d1 * 3];
+			for (int da = 0; da <= nd; ++da)
+			{
+				for (int db = 0; db <= nd; ++db)
+				{
+					for (int e = 0; e < 3; ++e)
+					{
+						real v = a[(da * d1 + db) * 3 + e];
+						if (!h) {
+							p[(da * d1 + db) * 3 + e] = v;
+							continue;
+						}
+						for (int i = 0; i <= da; ++i) {
+							for (int j = 0; j <= db; ++j) {
+								if (i > 0 || j > 0) {
+									v -= binomial(da, i) * binomial(db, j) * w[i * d1 + j]
+										* p[((da - i) * d1 + db - j) * 3 + e];
+								}
+							}
+						}
+						p[(da * d1 + db) * 3 + e] = v / w[0];
+					}
+				}
+			}
+		}
+	}
+	return out;
+}
+
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+// Reference evaluators for the correctness checks. Everything is computed
+// in long double straight from the textbook definitions, sharing no code
+// with the kernels under test: the full Cox-de Boor recursion over every
+// basis function, de Casteljau for Bezier curves.
+namespace oracle
+{
+
+typedef long double real;
+
+// control point component c of point i (or of net point i, j)
+typedef std::function<real(int i, int c)> CurveNet;
+typedef std::function<real(int i, int j, int c)> SurfaceNet;
+// weight of a point, empty for a non-rational evaluation
+typedef std::function<real(int i)> CurveWeights;
+typedef std::function<real(int i, int j)> SurfaceWeights;
+
+// open uniform (aitn::knot) and periodic uniform (aitn::knotu) vectors
+std::vector<real> open_knots(int npts, int c);
+std::vector<real> periodic_knots(int npts, int c);
+
+// Parameters as the kernels step them: t += step in T, snapped to `end`
+// within 5e-6, so the reference sees the exact same t values. rbsplineu
+// snaps to its last knot rather than the domain end and passes it here.
+template <typename T>
+std::vector<T> stepped_params(T start, T range, int samples, T end = -1)
+{
+	std::vector<T> t(samples);
+	if (end < 0) {
+		end = start + range;
+	}
+	const T step = range / static_cast<T>(samples - 1);
+	T v = start;
+	for (int i = 0; i < samples; ++i)
+	{
+		if (end - v < 5e-6) {
+			v = end;
+		}
+		t[i] = v;
+		v = v + step;
+	}
+	return t;
+}
+
+// all npts basis values at t, the last nonempty interval closed at the end
+void basis(int c, real t, int npts, const std::vector<real>& x, std::vector<real>& n);
+
+// the same and their first nd derivatives, derivative d of basis i at
+// n[d * npts + i], by differentiating the recursion once per order
+void basis_derivs(int c, real t, int npts, const std::vector<real>& x, int nd, std::vector<real>& n);
+
+// dim components per output point
+std::vector<real> bspline(int c, int npts, const std::vector<real>& x, const CurveNet& b,
+	const CurveWeights& h, const std::vector<real>& params, int dim);
+
+// nd = 0 for points, 1 or 2 for derivatives
+std::vector<real> bezier(int npts, const CurveNet& b, const std::vector<real>& params, int dim, int nd = 0);
+
+std::vector<real> surface(int k, int l, int npts, int mpts, const std::vector<real>& x,
+	const std::vector<real>& y, const SurfaceNet& b, const SurfaceWeights& h,
+	const std::vector<real>& uparams, const std::vector<real>& wparams);
+
+std::vector<real> bezsurf(int npts, int mpts, const SurfaceNet& b,
+	const std::vector<real>& uparams, const std::vector<real>& wparams);
+
+// C(t) and its first nd derivatives, (nd + 1) * 3 values per param; with
+// weights by the quotient rule on the homogeneous derivatives
+std::vector<real> bspline_derivs(int c, int npts, const std::vector<real>& x, const CurveNet& b,
+	const CurveWeights& h, const std::vector<real>& params, int nd);
+
+// every partial d^(a+b) S / du^a dw^b for a, b <= nd, (nd + 1)^2 * 3
+// values per (u, w) pair, w varying fastest, partial (a, b) at
+// (a * (nd + 1) + b) * 3 within a pair
+std::vector<real> surface_derivs(int k, int l, int npts, int mpts, const std::vector<real>& x,
+	const std::vector<real>& y, const SurfaceNet& b, const SurfaceWeights& h,
+	const std::vector<real>& uparams, const std::vector<real>& wparams, int nd);
+
+// max |out - ref| over max(1, max |ref|); out has `stride` values per
+// point of which the first dim are compared
+template <typename T>
+double max_error(const T* out, int stride, int dim, const std::vector<real>& ref)
+{
+	real scale = 1, err = 0;
+	const int n = static_cast<int>(ref.size()) / dim;
+	for (int i = 0; i < n; ++i)
+	{
+		for (int c = 0; c < dim; ++c)
+		{
+			const real r = ref[i * dim + c];
+			const real d = static_cast<real>(out[i * stride + c]) - r;
+			scale = r > scale ? r : (-r > scale ? -r : scale);
+			err = d > err ? d : (-d > err ? -d : err);
+		}
+	}
+	return static_cast<double>(err / scale);
+}
+
+}
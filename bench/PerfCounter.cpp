@@ -0,0 +1,59 @@
+#include "PerfCounter.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+PerfCounter::PerfCounter()
+	: m_fd(-1)
+{
+#if defined(__linux__)
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	m_fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+}
+
+PerfCounter::~PerfCounter()
+{
+#if defined(__linux__)
+	if (m_fd >= 0) {
+		close(m_fd);
+	}
+#endif
+}
+
+void PerfCounter::Start()
+{
+#if defined(__linux__)
+	if (m_fd >= 0) {
+		ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+long long PerfCounter::Stop()
+{
+#if defined(__linux__)
+	if (m_fd >= 0)
+	{
+		ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+		long long count = 0;
+		if (read(m_fd, &count, sizeof(count)) == sizeof(count)) {
+			return count;
+		}
+	}
+#endif
+	return -1;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+// Hardware cache-miss counter of the calling thread through perf_event.
+// Invalid (and Stop() returns -1) off Linux or when the kernel refuses it,
+// e.g. under a restrictive perf_event_paranoid or in a container.
+class PerfCounter
+{
+public:
+	PerfCounter();
+	~PerfCounter();
+
+	PerfCounter(const PerfCounter&) = delete;
+	PerfCounter& operator = (const PerfCounter&) = delete;
+
+	bool IsValid() const { return m_fd >= 0; }
+
+	void Start();
+	long long Stop();
+
+private:
+	int m_fd;
+
+}; // PerfCounter
@@ -0,0 +1,2280 @@
+// Benchmark and correctness harness for the public nurbs functions and the
+// aitn kernels behind them.
+//
+//   nurbs_bench [--quick] [--filter=text] [--min-time=ms] [--no-check] [--csv]
+//
+// Every case is timed until a batch of calls takes at least min-time and
+// reports ns per output point (per query for closest points) and its
+// inverse in million points per second, operator new calls per call and
+// cache misses per call (perf_event, "-" where unavailable). Unless
+// --no-check is given each case is first compared against the long double
+// evaluation in Oracle.h, the SIMD batch cases against their Scalar level
+// in ULP; the exit code is 1 if any case is outside its tolerance.
+
+#include "AllocCounter.h"
+#include "PerfCounter.h"
+#include "Oracle.h"
+
+#include "../include/nurbs/nurbs.h"
+#include "../include/nurbs/BatchEval.h"
+#include "../include/nurbs/TessPlan.h"
+#include "../include/nurbs/SurfaceTess.h"
+#include "../include/nurbs/Extraction.h"
+#include "../include/nurbs/Incremental.h"
+#include "../include/nurbs/Projection.h"
+#include "../include/nurbs/ThreadPool.h"
+#include "../external/aitn/bezier.h"
+#include "../external/aitn/bezsurf.h"
+#include "../external/aitn/bspline.h"
+#include "../external/aitn/bspsurf.h"
+#include "../external/aitn/rbspline.h"
+#include "../external/aitn/rbspsurf.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+using oracle::real;
+
+struct Case
+{
+	std::string kernel;
+	const char* precision;
+	int order;		// 0 where it does not apply
+	int npts;		// control points, per direction for surfaces
+	int points;		// output points per call
+
+	std::function<void()> run;
+	// error of the output of the last run() against the oracle
+	std::function<double()> error;
+	double tol;
+};
+
+struct Sweep
+{
+	std::vector<int> orders, npts, samples;
+	std::vector<int> bez_npts;
+	// control net sizes of the workspace against allocating comparison
+	std::vector<int> work_npts;
+	std::vector<int> surf_orders, surf_npts, surf_samples;
+	std::vector<int> bezsurf_npts;
+	// surface nets of the drag latency comparison
+	std::vector<int> drag_npts;
+	// curve nets of the projection comparison, across the scan to tree switch
+	std::vector<int> project_npts;
+};
+
+Sweep full_sweep()
+{
+	Sweep s;
+	s.orders       = { 2, 3, 4, 6 };
+	s.npts         = { 8, 64, 512 };
+	s.samples      = { 64, 1024, 16384 };
+	s.bez_npts     = { 4, 8, 11, 16 };
+	s.work_npts    = { 8, 64, 512, 4096, 32768 };
+	s.surf_orders  = { 2, 3, 4 };
+	s.surf_npts    = { 8, 32 };
+	s.surf_samples = { 32, 128 };
+	s.bezsurf_npts = { 4, 8 };
+	s.drag_npts    = { 8, 32, 128 };
+	s.project_npts = { 8, 16, 32, 64, 128, 256, 512 };
+	return s;
+}
+
+Sweep quick_sweep()
+{
+	Sweep s;
+	s.orders       = { 3, 4 };
+	s.npts         = { 16, 128 };
+	s.samples      = { 256, 4096 };
+	s.bez_npts     = { 4, 8, 11 };
+	s.work_npts    = { 8, 512, 8192 };
+	s.surf_orders  = { 3, 4 };
+	s.surf_npts    = { 8, 16 };
+	s.surf_samples = { 32, 96 };
+	s.bezsurf_npts = { 4 };
+	s.drag_npts    = { 8, 32 };
+	s.project_npts = { 16, 128 };
+	return s;
+}
+
+template <typename T> const char* precision_name();
+template <> const char* precision_name<float>() { return "float"; }
+template <> const char* precision_name<double>() { return "double"; }
+
+// rounding of one evaluation over a parameter range of `range`
+template <typename T>
+double tolerance(double range, double factor = 1)
+{
+	return 512 * std::numeric_limits<T>::epsilon() * (range > 1 ? range : 1) * factor;
+}
+
+// control values in [-1, 1], weights in [0.5, 2]
+template <typename T>
+std::shared_ptr<std::vector<T>> random_values(int count, unsigned seed, T lo = -1, T hi = 1)
+{
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<double> dist(lo, hi);
+	auto v = std::make_shared<std::vector<T>>(count);
+	for (auto& x : *v) {
+		x = static_cast<T>(dist(gen));
+	}
+	return v;
+}
+
+template <typename T>
+std::vector<real> to_real(const std::vector<T>& v)
+{
+	return std::vector<real>(v.begin(), v.end());
+}
+
+//////////////////////////////////////////////////////////////////////////
+// aitn curves
+//////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+void add_aitn_bspline(std::vector<Case>& cases, int k, int npts, int p1, bool rational, bool periodic)
+{
+	auto b = random_values<T>(npts * 3, npts * 31 + k);
+	auto h = random_values<T>(npts, npts * 17 + k, T(0.5), T(2));
+	auto p = std::make_shared<std::vector<T>>(p1 * 3);
+	auto x = std::make_shared<std::vector<int>>(aitn::bsp_knot_size(npts, k));
+	auto work = std::make_shared<std::vector<T>>(aitn::bsp_work_size(npts, k));
+
+	Case c;
+	c.kernel = std::string("aitn::") + (rational ? "rbspline" : "bspline") + (periodic ? "u" : "");
+	c.precision = precision_name<T>();
+	c.order = k;
+	c.npts = npts;
+	c.points = p1;
+	c.run = [=]() {
+		if (rational && periodic) {
+			aitn::rbsplineu(npts, k, p1, b->data(), h->data(), p->data(), x->data(), work->data());
+		} else if (rational) {
+			aitn::rbspline(npts, k, p1, b->data(), h->data(), p->data(), x->data(), work->data());
+		} else if (periodic) {
+			aitn::bsplineu(npts, k, p1, b->data(), p->data(), x->data(), work->data());
+		} else {
+			aitn::bspline(npts, k, p1, b->data(), p->data(), x->data(), work->data());
+		}
+	};
+
+	const T start = periodic ? T(k - 1) : T(0);
+	const T range = static_cast<T>(npts - k + 1);
+	c.error = [=]() {
+		const T snap = rational && periodic ? static_cast<T>(npts + k - 1) : T(-1);
+		auto params = oracle::stepped_params<T>(start, range, p1, snap);
+		auto knots = periodic ? oracle::periodic_knots(npts, k) : oracle::open_knots(npts, k);
+		oracle::CurveWeights weights;
+		if (rational) {
+			weights = [&](int i) -> real { return (*h)[i]; };
+		}
+		auto ref = oracle::bspline(k, npts, knots, [&](int i, int d) -> real { return (*b)[i * 3 + d]; },
+			weights, to_real(params), 3);
+		return oracle::max_error(p->data(), 3, 3, ref);
+	};
+	c.tol = tolerance<T>(start + range);
+	cases.push_back(c);
+}
+
+// The convenience overload allocates its knot vector and workspace on
+// every call; the workspace overload takes them from the caller. Both
+// should cost the same on small nets and grow only with the knot vector
+// set up per call on large ones.
+template <typename T>
+void add_aitn_workspace(std::vector<Case>& cases, int k, int npts, int p1, bool alloc)
+{
+	auto b = random_values<T>(npts * 3, npts * 23 + k);
+	auto p = std::make_shared<std::vector<T>>(p1 * 3);
+	auto x = std::make_shared<std::vector<int>>(aitn::bsp_knot_size(npts, k));
+	auto work = std::make_shared<std::vector<T>>(aitn::bsp_work_size(npts, k));
+
+	Case c;
+	c.kernel = alloc ? "aitn::bspline(alloc)" : "aitn::bspline(work)";
+	c.precision = precision_name<T>();
+	c.order = k;
+	c.npts = npts;
+	c.points = p1;
+	c.run = [=]() {
+		if (alloc) {
+			aitn::bspline(npts, k, p1, b->data(), p->data());
+		} else {
+			aitn::bspline(npts, k, p1, b->data(), p->data(), x->data(), work->data());
+		}
+	};
+
+	const T range = static_cast<T>(npts - k + 1);
+	c.error = [=]() {
+		auto params = oracle::stepped_params<T>(0, range, p1);
+		auto ref = oracle::bspline(k, npts, oracle::open_knots(npts, k),
+			[&](int i, int d) -> real { return (*b)[i * 3 + d]; },
+			oracle::CurveWeights(), to_real(params), 3);
+		return oracle::max_error(p->data(), 3, 3, ref);
+	};
+	c.tol = tolerance<T>(range);
+	cases.push_back(c);
+}
+
+// The dense basis runs the recursion over all npts + c knots and its
+// curve sums over every control point; basis_span touches the c nonzero
+// functions of the span found by binary search.
+template <typename T>
+void add_aitn_basis(std::vector<Case>& cases, int k, int npts, int p1, bool dense)
+{
+	auto b = random_values<T>(npts * 3, npts * 29 + k);
+	auto p = std::make_shared<std::vector<T>>(p1 * 3);
+	auto x = std::make_shared<std::vector<int>>(aitn::bsp_knot_size(npts, k));
+	auto n = std::make_shared<std::vector<T>>(dense ? npts : k);
+	auto temp = std::make_shared<std::vector<T>>(dense ? npts + k : 2 * k);
+	aitn::knot(npts, k, x->data());
+
+	const T range = static_cast<T>(npts - k + 1);
+	auto params = std::make_shared<std::vector<T>>(oracle::stepped_params<T>(0, range, p1));
+
+	Case c;
+	c.kernel = dense ? "aitn::basis" : "aitn::basis_span";
+	c.precision = precision_name<T>();
+	c.order = k;
+	c.npts = npts;
+	c.points = p1;
+	c.run = [=]() {
+		for (int i = 0; i < p1; ++i)
+		{
+			const T t = (*params)[i];
+			int first = 0, num = npts;
+			if (dense) {
+				aitn::basis(k, t, npts, x->data(), n->data(), temp->data());
+			} else {
+				const int span = aitn::find_span(k, t, npts, x->data());
+				aitn::basis_span(k, t, span, x->data(), n->data(), temp->data(), temp->data() + k);
+				first = span - k + 1;
+				num = k;
+			}
+			T* q = p->data() + i * 3;
+			q[0] = q[1] = q[2] = 0;
+			for (int j = 0; j < num; ++j) {
+				const T* v = b->data() + (first + j) * 3;
+				q[0] += (*n)[j] * v[0];
+				q[1] += (*n)[j] * v[1];
+				q[2] += (*n)[j] * v[2];
+			}
+		}
+	};
+	c.error = [=]() {
+		auto ref = oracle::bspline(k, npts, oracle::open_knots(npts, k),
+			[&](int i, int d) -> real { return (*b)[i * 3 + d]; },
+			oracle::CurveWeights(), to_real(*params), 3);
+		return oracle::max_error(p->data(), 3, 3, ref);
+	};
+	c.tol = tolerance<T>(range);
+	cases.push_back(c);
+}
+
+template <typename T>
+void add_aitn_bezier(std::vector<Case>& cases, int npts, int cpts, int variant)
+{
+	auto b = random_values<T>(npts * 3, npts * 7 + variant);
+	auto p = std::make_shared<std::vector<T>>(cpts * 3);
+	auto d1 = std::make_shared<std::vector<T>>(cpts * 3);
+	auto d2 = std::make_shared<std::vector<T>>(cpts * 3);
+	auto work = std::make_shared<std::vector<T>>(npts * (2 * 3 + 1));
+
+	static const char* NAMES[] = { "aitn::bezier", "aitn::bezier_fd", "aitn::dbezier" };
+
+	Case c;
+	c.kernel = NAMES[variant];
+	c.precision = precision_name<T>();
+	c.order = npts;
+	c.npts = npts;
+	c.points = cpts;
+	c.run = [=]() {
+		switch (variant)
+		{
+		case 0:
+			aitn::bezier<T, 3>(npts, b->data(), cpts, p->data());
+			break;
+		case 1:
+			aitn::bezier_fd<T, 3>(npts, b->data(), cpts, p->data(), work->data());
+			break;
+		default:
+			aitn::dbezier<T, 3>(npts, b->data(), cpts, p->data(), d1->data(), d2->data());
+			break;
+		}
+	};
+	c.error = [=]() {
+		auto params = to_real(oracle::stepped_params<T>(0, 1, cpts));
+		oracle::CurveNet net = [&](int i, int d) -> real { return (*b)[i * 3 + d]; };
+		double err = oracle::max_error(p->data(), 3, 3, oracle::bezier(npts, net, params, 3));
+		if (variant == 2)
+		{
+			double e1 = oracle::max_error(d1->data(), 3, 3, oracle::bezier(npts, net, params, 3, 1));
+			double e2 = oracle::max_error(d2->data(), 3, 3, oracle::bezier(npts, net, params, 3, 2));
+			err = std::max(err, std::max(e1, e2));
+		}
+		return err;
+	};
+	// forward differencing accumulates one rounding per step and order
+	c.tol = variant == 1 ? tolerance<T>(1, static_cast<double>(cpts) * npts) : tolerance<T>(1, npts);
+	cases.push_back(c);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// aitn surfaces
+//////////////////////////////////////////////////////////////////////////
+
+// variant: 0 bsplsurf, 1 bspsurfu, 2 rbspsurf
+template <typename T>
+void add_aitn_bspsurf(std::vector<Case>& cases, int k, int npts, int p, int variant)
+{
+	const int l = k;
+	const int mpts = npts;
+	const int comp = variant == 2 ? 4 : 3;
+	const int row = mpts;
+	auto b = random_values<T>(npts * row * comp, npts * 13 + k + variant);
+	if (variant == 2) {
+		for (int i = 0; i < npts * row; ++i) {
+			(*b)[i * 4 + 3] = static_cast<T>(0.5 + 1.5 * ((i * 7919) % 101) / 100.0);
+		}
+	}
+	auto q = std::make_shared<std::vector<T>>(p * p * 3);
+	auto x = std::make_shared<std::vector<int>>(aitn::bsp_knot_size(npts, k));
+	auto y = std::make_shared<std::vector<int>>(aitn::bsp_knot_size(mpts, l));
+	auto work = std::make_shared<std::vector<T>>(aitn::bspsurf_work_size(npts, mpts, k, l));
+
+	static const char* NAMES[] = { "aitn::bsplsurf", "aitn::bspsurfu", "aitn::rbspsurf" };
+
+	Case c;
+	c.kernel = NAMES[variant];
+	c.precision = precision_name<T>();
+	c.order = k;
+	c.npts = npts;
+	c.points = p * p;
+	c.run = [=]() {
+		switch (variant)
+		{
+		case 0:
+			aitn::bsplsurf(b->data(), k, l, npts, mpts, p, p, q->data(), x->data(), y->data(), work->data());
+			break;
+		case 1:
+			aitn::bspsurfu(b->data(), k, l, npts, mpts, p, p, q->data(), x->data(), y->data(), work->data());
+			break;
+		default:
+			aitn::rbspsurf(b->data(), k, l, npts, mpts, p, p, q->data(), x->data(), y->data(), work->data());
+			break;
+		}
+	};
+
+	const bool periodic = variant == 1;
+	const T start = periodic ? T(k - 1) : T(0);
+	const T range = static_cast<T>(npts - k + 1);
+	c.error = [=]() {
+		auto params = to_real(oracle::stepped_params<T>(start, range, p));
+		auto knots = periodic ? oracle::periodic_knots(npts, k) : oracle::open_knots(npts, k);
+		oracle::SurfaceWeights weights;
+		if (variant == 2) {
+			weights = [&](int i, int j) -> real { return (*b)[(i * row + j) * 4 + 3]; };
+		}
+		auto ref = oracle::surface(k, l, npts, mpts, knots, knots,
+			[&](int i, int j, int d) -> real { return (*b)[(i * row + j) * comp + d]; },
+			weights, params, params);
+		return oracle::max_error(q->data(), 3, 3, ref);
+	};
+	c.tol = tolerance<T>(start + range, 2);
+	cases.push_back(c);
+}
+
+template <typename T>
+void add_aitn_bezsurf(std::vector<Case>& cases, int npts, int p)
+{
+	const int mpts = npts;
+	auto b = random_values<T>(npts * mpts * 3, npts * 5 + p);
+	auto q = std::make_shared<std::vector<T>>(p * p * 3);
+	auto work = std::make_shared<std::vector<T>>(npts + mpts);
+
+	Case c;
+	c.kernel = "aitn::bezsurf";
+	c.precision = precision_name<T>();
+	c.order = npts;
+	c.npts = npts;
+	c.points = p * p;
+	c.run = [=]() {
+		aitn::bezsurf(b->data(), npts - 1, mpts - 1, p, p, q->data(), work->data());
+	};
+	c.error = [=]() {
+		auto params = to_real(oracle::stepped_params<T>(0, 1, p));
+		auto ref = oracle::bezsurf(npts, mpts,
+			[&](int i, int j, int d) -> real { return (*b)[(i * mpts + j) * 3 + d]; }, params, params);
+		return oracle::max_error(q->data(), 3, 3, ref);
+	};
+	c.tol = tolerance<T>(1, npts);
+	cases.push_back(c);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// nurbs.h, float only
+//////////////////////////////////////////////////////////////////////////
+
+// variant: 0 bezier, 1 bspline, 2 rbspline; view selects the PointView
+// overloads over the std::vector<sm::vec2> ones
+void add_nurbs_curve(std::vector<Case>& cases, int k, int npts, int samples, int variant, bool view)
+{
+	auto raw = random_values<float>(npts * 3, npts * 11 + k + variant);
+	auto h = random_values<float>(npts, npts * 3 + k, 0.5f, 2.0f);
+	auto ctl2 = std::make_shared<std::vector<sm::vec2>>(npts);
+	for (int i = 0; i < npts; ++i) {
+		(*ctl2)[i] = sm::vec2((*raw)[i * 3], (*raw)[i * 3 + 1]);
+	}
+	auto out2 = std::make_shared<std::vector<sm::vec2>>(samples);
+	auto out3 = std::make_shared<std::vector<float>>(samples * 3);
+
+	static const char* NAMES[] = { "nurbs::bezier", "nurbs::bspline", "nurbs::rbspline" };
+
+	Case c;
+	c.kernel = std::string(NAMES[variant]) + (view ? "(view)" : "(vec2)");
+	c.precision = "float";
+	c.order = variant == 0 ? npts : k;
+	c.npts = npts;
+	c.points = samples;
+	c.run = [=]() {
+		if (view)
+		{
+			const float* src = raw->data();
+			float* dst = out3->data();
+			auto in = nurbs::make_view(src, src + 1, src + 2, 3 * sizeof(float), npts);
+			auto out = nurbs::make_view(dst, dst + 1, dst + 2, 3 * sizeof(float), samples);
+			switch (variant)
+			{
+			case 0:
+				nurbs::bezier(in, out);
+				break;
+			case 1:
+				nurbs::bspline(in, k, out);
+				break;
+			default:
+				nurbs::rbspline(in, h->data(), k, out);
+				break;
+			}
+		}
+		else
+		{
+			switch (variant)
+			{
+			case 0:
+				nurbs::bezier(*ctl2, *out2);
+				break;
+			case 1:
+				nurbs::bspline(*ctl2, k, *out2);
+				break;
+			default:
+				nurbs::rbspline(*ctl2, k, *out2);
+				break;
+			}
+		}
+	};
+
+	const float range = variant == 0 ? 1.0f : static_cast<float>(npts - k + 1);
+	c.error = [=]() {
+		const int dim = view ? 3 : 2;
+		auto params = to_real(oracle::stepped_params<float>(0, range, samples));
+		oracle::CurveNet net = [&](int i, int d) -> real { return (*raw)[i * 3 + d]; };
+		std::vector<real> ref;
+		if (variant == 0)
+		{
+			ref = oracle::bezier(npts, net, params, dim);
+		}
+		else
+		{
+			oracle::CurveWeights weights;
+			if (variant == 2) {
+				weights = view ? oracle::CurveWeights([&](int i) -> real { return (*h)[i]; })
+					: oracle::CurveWeights([](int) -> real { return 1; });
+			}
+			ref = oracle::bspline(k, npts, oracle::open_knots(npts, k), net, weights, params, dim);
+		}
+		return view ? oracle::max_error(out3->data(), 3, 3, ref)
+			: oracle::max_error(&(*out2)[0].x, 2, 2, ref);
+	};
+	c.tol = variant == 0 ? tolerance<float>(1, npts) : tolerance<float>(range);
+	cases.push_back(c);
+}
+
+// variant: 0 bezsurf, 1 bspsurf, 2 rbspsurf, 3 rbspsurf with weights
+void add_nurbs_surface(std::vector<Case>& cases, int k, int npts, int p, int variant)
+{
+	const int mpts = npts;
+	auto raw = random_values<float>(npts * mpts * 3, npts * 19 + k + variant);
+	auto h = random_values<float>(npts * mpts, npts * 23 + k, 0.5f, 2.0f);
+	auto ctl = std::make_shared<std::vector<sm::vec3>>(npts * mpts);
+	for (int i = 0; i < npts * mpts; ++i) {
+		(*ctl)[i] = sm::vec3((*raw)[i * 3], (*raw)[i * 3 + 1], (*raw)[i * 3 + 2]);
+	}
+	auto out = std::make_shared<std::vector<sm::vec3>>();
+
+	static const char* NAMES[] = { "nurbs::bezsurf", "nurbs::bspsurf", "nurbs::rbspsurf",
+		"nurbs::rbspsurf(weights)" };
+
+	Case c;
+	c.kernel = NAMES[variant];
+	c.precision = "float";
+	c.order = variant == 0 ? npts : k;
+	c.npts = npts;
+	c.points = p * p;
+	c.run = [=]() {
+		switch (variant)
+		{
+		case 0:
+			nurbs::bezsurf(ctl->data(), npts, mpts, p, p, *out);
+			break;
+		case 1:
+			nurbs::bspsurf(ctl->data(), k, k, npts, mpts, p, p, *out);
+			break;
+		case 2:
+			nurbs::rbspsurf(ctl->data(), k, k, npts, mpts, p, p, *out);
+			break;
+		default:
+			nurbs::rbspsurf(ctl->data(), h->data(), k, k, npts, mpts, p, p, *out);
+			break;
+		}
+	};
+
+	const float range = variant == 0 ? 1.0f : static_cast<float>(npts - k + 1);
+	c.error = [=]() {
+		auto params = to_real(oracle::stepped_params<float>(0, range, p));
+		oracle::SurfaceNet net = [&](int i, int j, int d) -> real { return (*raw)[(i * mpts + j) * 3 + d]; };
+		std::vector<real> ref;
+		if (variant == 0)
+		{
+			ref = oracle::bezsurf(npts, mpts, net, params, params);
+		}
+		else
+		{
+			oracle::SurfaceWeights weights;
+			if (variant == 3) {
+				weights = [&](int i, int j) -> real { return (*h)[i * mpts + j]; };
+			}
+			auto knots = oracle::open_knots(npts, k);
+			ref = oracle::surface(k, k, npts, mpts, knots, knots, net, weights, params, params);
+		}
+		return oracle::max_error(&(*out)[0].x, 3, 3, ref);
+	};
+	c.tol = variant == 0 ? tolerance<float>(1, npts) : tolerance<float>(range, 2);
+	cases.push_back(c);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+void add_aitn_cases(std::vector<Case>& cases, const Sweep& s)
+{
+	for (int k : s.orders) {
+		for (int npts : s.npts) {
+			for (int p1 : s.samples) {
+				if (npts < k) {
+					continue;
+				}
+				add_aitn_bspline<T>(cases, k, npts, p1, false, false);
+				add_aitn_bspline<T>(cases, k, npts, p1, false, true);
+				add_aitn_bspline<T>(cases, k, npts, p1, true, false);
+				add_aitn_bspline<T>(cases, k, npts, p1, true, true);
+			}
+		}
+	}
+	for (int npts : s.work_npts) {
+		for (int alloc = 0; alloc < 2; ++alloc) {
+			add_aitn_workspace<T>(cases, s.orders.back(), npts, s.samples.front(), alloc != 0);
+		}
+	}
+	for (int npts : s.work_npts) {
+		for (int dense = 0; dense < 2; ++dense) {
+			add_aitn_basis<T>(cases, s.orders.back(), npts, s.samples.front(), dense != 0);
+		}
+	}
+	for (int npts : s.bez_npts) {
+		for (int p1 : s.samples) {
+			for (int variant = 0; variant < 3; ++variant) {
+				add_aitn_bezier<T>(cases, npts, p1, variant);
+			}
+		}
+	}
+	for (int k : s.surf_orders) {
+		for (int npts : s.surf_npts) {
+			for (int p : s.surf_samples) {
+				for (int variant = 0; variant < 3; ++variant) {
+					add_aitn_bspsurf<T>(cases, k, npts, p, variant);
+				}
+			}
+		}
+	}
+	for (int npts : s.bezsurf_npts) {
+		for (int p : s.surf_samples) {
+			add_aitn_bezsurf<T>(cases, npts, p);
+		}
+	}
+}
+
+void add_nurbs_cases(std::vector<Case>& cases, const Sweep& s)
+{
+	for (int view = 0; view < 2; ++view)
+	{
+		for (int k : s.orders) {
+			for (int npts : s.npts) {
+				for (int p1 : s.samples) {
+					if (npts >= k) {
+						add_nurbs_curve(cases, k, npts, p1, 1, view != 0);
+						add_nurbs_curve(cases, k, npts, p1, 2, view != 0);
+					}
+				}
+			}
+		}
+		for (int npts : s.bez_npts) {
+			for (int p1 : s.samples) {
+				add_nurbs_curve(cases, 0, npts, p1, 0, view != 0);
+			}
+		}
+	}
+	for (int k : s.surf_orders) {
+		for (int npts : s.surf_npts) {
+			for (int p : s.surf_samples) {
+				for (int variant = 1; variant < 4; ++variant) {
+					add_nurbs_surface(cases, k, npts, p, variant);
+				}
+			}
+		}
+	}
+	for (int npts : s.bezsurf_npts) {
+		for (int p : s.surf_samples) {
+			add_nurbs_surface(cases, 0, npts, p, 0);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// rational against non-rational on the same net: the quadratic circle,
+// weights 1 and sqrt(2)/2, once with and once without its weights
+//////////////////////////////////////////////////////////////////////////
+
+const int CIRCLE_NPTS = 9;
+
+// (x, y, 0) corners of the square around the unit circle and the
+// midpoints of its sides, starting and ending at (1, 0)
+std::vector<double> circle_net()
+{
+	static const double XY[CIRCLE_NPTS][2] = {
+		{ 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 }, { 1, 0 },
+	};
+	std::vector<double> net(CIRCLE_NPTS * 3, 0.0);
+	for (int i = 0; i < CIRCLE_NPTS; ++i) {
+		net[i * 3] = XY[i][0];
+		net[i * 3 + 1] = XY[i][1];
+	}
+	return net;
+}
+
+std::vector<double> circle_weights()
+{
+	std::vector<double> h(CIRCLE_NPTS);
+	for (int i = 0; i < CIRCLE_NPTS; ++i) {
+		h[i] = i % 2 == 0 ? 1.0 : std::sqrt(0.5);
+	}
+	return h;
+}
+
+// NurbsCurve::Tessellate with the circle's double knots at the quarters
+template <typename T>
+void add_circle_curve(std::vector<Case>& cases, int samples, bool rational)
+{
+	static const double KNOTS[CIRCLE_NPTS + 3] = { 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 4 };
+	const auto raw = circle_net();
+	const auto h = circle_weights();
+	std::vector<T> pts(raw.begin(), raw.end()), weights(h.begin(), h.end()), knots(KNOTS, KNOTS + CIRCLE_NPTS + 3);
+	auto curve = std::make_shared<nurbs::NurbsCurve<T>>(3, CIRCLE_NPTS, pts.data(),
+		rational ? weights.data() : nullptr, knots.data());
+	auto out = std::make_shared<std::vector<T>>(samples * 3);
+
+	Case c;
+	c.kernel = rational ? "circle NurbsCurve::Tessellate(w)" : "circle NurbsCurve::Tessellate";
+	c.precision = precision_name<T>();
+	c.order = 3;
+	c.npts = CIRCLE_NPTS;
+	c.points = samples;
+	c.run = [=]() {
+		curve->Tessellate(samples, out->data());
+	};
+	c.error = [=]() {
+		std::vector<real> params(samples);
+		for (int i = 0; i < samples; ++i) {
+			params[i] = static_cast<real>(i == samples - 1 ? T(4) : T(4) * i / (samples - 1));
+		}
+		oracle::CurveWeights cw;
+		if (rational) {
+			cw = [&](int i) -> real { return static_cast<T>(h[i]); };
+		}
+		auto ref = oracle::bspline(3, CIRCLE_NPTS, std::vector<real>(KNOTS, KNOTS + CIRCLE_NPTS + 3),
+			[&](int i, int d) -> real { return static_cast<T>(raw[i * 3 + d]); }, cw, params, 3);
+		return oracle::max_error(out->data(), 3, 3, ref);
+	};
+	c.tol = tolerance<T>(4);
+	cases.push_back(c);
+}
+
+// nurbs::bspline against nurbs::rbspline through the PointView overloads;
+// their open uniform knots make each span a conic arc, not the circle
+void add_circle_view(std::vector<Case>& cases, int samples, bool rational)
+{
+	const auto raw = circle_net();
+	const auto h = circle_weights();
+	auto pts = std::make_shared<std::vector<float>>(raw.begin(), raw.end());
+	auto weights = std::make_shared<std::vector<float>>(h.begin(), h.end());
+	auto out = std::make_shared<std::vector<float>>(samples * 3);
+
+	Case c;
+	c.kernel = rational ? "circle nurbs::rbspline(view)" : "circle nurbs::bspline(view)";
+	c.precision = "float";
+	c.order = 3;
+	c.npts = CIRCLE_NPTS;
+	c.points = samples;
+	c.run = [=]() {
+		const float* src = pts->data();
+		float* dst = out->data();
+		auto in = nurbs::make_view(src, src + 1, src + 2, 3 * sizeof(float), CIRCLE_NPTS);
+		auto view = nurbs::make_view(dst, dst + 1, dst + 2, 3 * sizeof(float), samples);
+		if (rational) {
+			nurbs::rbspline(in, weights->data(), 3, view);
+		} else {
+			nurbs::bspline(in, 3, view);
+		}
+	};
+	const float range = static_cast<float>(CIRCLE_NPTS - 3 + 1);
+	c.error = [=]() {
+		auto params = to_real(oracle::stepped_params<float>(0, range, samples));
+		oracle::CurveWeights cw;
+		if (rational) {
+			cw = [&](int i) -> real { return (*weights)[i]; };
+		}
+		auto ref = oracle::bspline(3, CIRCLE_NPTS, oracle::open_knots(CIRCLE_NPTS, 3),
+			[&](int i, int d) -> real { return (*pts)[i * 3 + d]; }, cw, params, 3);
+		return oracle::max_error(out->data(), 3, 3, ref);
+	};
+	c.tol = tolerance<float>(range);
+	cases.push_back(c);
+}
+
+void add_circle_cases(std::vector<Case>& cases, const Sweep& s)
+{
+	// each pair on adjacent lines
+	for (int samples : s.samples)
+	{
+		for (int rational = 0; rational < 2; ++rational) {
+			add_circle_curve<float>(cases, samples, rational != 0);
+		}
+		for (int rational = 0; rational < 2; ++rational) {
+			add_circle_curve<double>(cases, samples, rational != 0);
+		}
+		for (int rational = 0; rational < 2; ++rational) {
+			add_circle_view(cases, samples, rational != 0);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BatchEval.h at every SIMD level the CPU runs, checked in ULP against
+// the Scalar level rather than the oracle
+//////////////////////////////////////////////////////////////////////////
+
+// largest difference in ULP of the largest reference magnitude, the unit
+// of the bound in BatchEval.h
+double max_ulp(const std::vector<float>& out, const std::vector<float>& ref)
+{
+	float scale = 0;
+	for (float v : ref) {
+		scale = std::max(scale, std::fabs(v));
+	}
+	const double ulp = std::nextafter(scale, std::numeric_limits<float>::infinity()) - scale;
+	double err = 0;
+	for (size_t i = 0; i < out.size(); ++i) {
+		err = std::max(err, std::fabs(static_cast<double>(out[i]) - ref[i]) / ulp);
+	}
+	return err;
+}
+
+// variant: 0 batch_eval, 1 batch_eval_surface, 2 batch_eval_rational,
+// 3 batch_eval_surface_rational; npts and samples per direction
+void add_batch_eval(std::vector<Case>& cases, int k, int npts, int samples, nurbs::SimdLevel level, int variant)
+{
+	const bool surface = variant == 1 || variant == 3;
+	const bool rational = variant >= 2;
+	const int size = surface ? npts * npts : npts;
+	const int points = surface ? samples * samples : samples;
+
+	auto plan = std::make_shared<nurbs::TessPlan>(nurbs::TessPlan::Key{ k, npts, samples, nurbs::KnotType::Open });
+	auto net = random_values<float>(size * 3, npts * 37 + k + variant);
+	auto h = random_values<float>(size, npts * 41 + k, 0.5f, 2.0f);
+	auto out = std::make_shared<std::vector<float>>(points * 3);
+	const int work_size = surface ? 3 * size + points + 4 * npts : 3 * npts + samples;
+	auto work = std::make_shared<std::vector<float>>(work_size);
+
+	// one call at the given level into dst, 3 SoA components
+	auto eval = [=](nurbs::SimdLevel lv, float* dst) {
+		const float* x = net->data();
+		const float* y = x + size;
+		const float* z = y + size;
+		float* ox = dst;
+		float* oy = ox + points;
+		float* oz = oy + points;
+		switch (variant)
+		{
+		case 0:
+			nurbs::batch_eval(*plan, x, y, z, ox, oy, oz, lv);
+			break;
+		case 1:
+			nurbs::batch_eval_surface(*plan, *plan, x, y, z, ox, oy, oz, work->data(), lv);
+			break;
+		case 2:
+			nurbs::batch_eval_rational(*plan, x, y, z, h->data(), ox, oy, oz, work->data(), lv);
+			break;
+		default:
+			nurbs::batch_eval_surface_rational(*plan, *plan, x, y, z, h->data(), ox, oy, oz, work->data(), lv);
+			break;
+		}
+	};
+
+	static const char* NAMES[] = { "batch_eval", "batch_eval_surface", "batch_eval_rational",
+		"batch_eval_surface_rational" };
+
+	Case c;
+	c.kernel = std::string(NAMES[variant]) + "(" + nurbs::simd_name(level) + ")";
+	c.precision = "float";
+	c.order = k;
+	c.npts = npts;
+	c.points = points;
+	c.run = [=]() {
+		eval(level, out->data());
+	};
+	c.error = [=]() {
+		std::vector<float> ref(out->size());
+		eval(nurbs::SimdLevel::Scalar, ref.data());
+		return max_ulp(*out, ref);
+	};
+	// k ULP per curve pass, two passes for a surface, the divide on top
+	c.tol = (surface ? 2 * k : k) + (rational ? 1 : 0);
+	cases.push_back(c);
+}
+
+void add_batch_cases(std::vector<Case>& cases, const Sweep& s)
+{
+	const int top = static_cast<int>(nurbs::simd_detect());
+	for (int lv = 0; lv <= top; ++lv)
+	{
+		const nurbs::SimdLevel level = static_cast<nurbs::SimdLevel>(lv);
+		for (int k : s.orders) {
+			for (int npts : s.npts) {
+				for (int p1 : s.samples) {
+					if (npts >= k) {
+						add_batch_eval(cases, k, npts, p1, level, 0);
+						add_batch_eval(cases, k, npts, p1, level, 2);
+					}
+				}
+			}
+		}
+		for (int k : s.surf_orders) {
+			for (int npts : s.surf_npts) {
+				for (int p : s.surf_samples) {
+					add_batch_eval(cases, k, npts, p, level, 1);
+					add_batch_eval(cases, k, npts, p, level, 3);
+				}
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// SurfaceTess.h on pools of 1, 2, 4 ... hardware threads, each output
+// compared byte for byte with the single-threaded tessellate()
+//////////////////////////////////////////////////////////////////////////
+
+const int TESS_PATCHES = 12;
+
+// the patches point into nets and out, so all three live together
+struct TessData
+{
+	std::vector<std::vector<float>> nets;
+	std::vector<float> out;
+	std::vector<nurbs::SurfacePatch> patches;
+};
+
+// patches cycle through Bezier (npts x npts net, degree npts - 1 capped
+// at 3), B-spline and rational B-spline, order k, p x p samples each
+void add_tessellate_pool(std::vector<Case>& cases, int k, int npts, int p, int threads)
+{
+	const int bez_npts = std::min(npts, 4);
+	auto data = std::make_shared<TessData>();
+	data->nets.resize(TESS_PATCHES);
+	data->out.resize(TESS_PATCHES * p * p * 3);
+	data->patches.resize(TESS_PATCHES);
+	for (int i = 0; i < TESS_PATCHES; ++i)
+	{
+		const auto type = static_cast<nurbs::SurfaceType>(i % 3);
+		const int n = type == nurbs::SurfaceType::Bezier ? bez_npts : npts;
+		const int comp = type == nurbs::SurfaceType::RBSpline ? 4 : 3;
+		auto& net = data->nets[i];
+		net = *random_values<float>(n * n * comp, npts * 43 + k + i);
+		if (comp == 4) {
+			for (int j = 0; j < n * n; ++j) {
+				net[j * 4 + 3] = 0.5f + 1.5f * ((j * 7919) % 101) / 100.0f;
+			}
+		}
+		data->patches[i] = { type, net.data(), n, n, n, k, k, p, p, &data->out[i * p * p * 3], nullptr };
+	}
+
+	auto pool = std::make_shared<nurbs::ThreadPool>(threads);
+
+	Case c;
+	c.kernel = "nurbs::tessellate(" + std::to_string(threads) + " threads)";
+	c.precision = "float";
+	c.order = k;
+	c.npts = npts;
+	c.points = TESS_PATCHES * p * p;
+	c.run = [=]() {
+		nurbs::tessellate(data->patches.data(), TESS_PATCHES, *pool, 32);
+	};
+	// 0 when every patch matches the single-threaded reference bit for bit
+	c.error = [=]() {
+		std::vector<float> ref(p * p * 3);
+		double mismatched = 0;
+		for (int i = 0; i < TESS_PATCHES; ++i)
+		{
+			nurbs::SurfacePatch patch = data->patches[i];
+			patch.out = ref.data();
+			nurbs::tessellate(patch);
+			if (memcmp(ref.data(), data->patches[i].out, ref.size() * sizeof(float)) != 0) {
+				++mismatched;
+			}
+		}
+		return mismatched;
+	};
+	c.tol = 0;
+	cases.push_back(c);
+}
+
+void add_tessellate_cases(std::vector<Case>& cases, const Sweep& s)
+{
+	// at least two threads so that the bit-identical check spans workers
+	const int hw = std::max(static_cast<int>(std::thread::hardware_concurrency()), 2);
+	std::vector<int> threads;
+	for (int t = 1; t < hw; t *= 2) {
+		threads.push_back(t);
+	}
+	threads.push_back(hw);
+
+	for (int t : threads) {
+		add_tessellate_pool(cases, s.surf_orders.back(), s.surf_npts.back(), s.surf_samples.back(), t);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// dragging one control point of the middle of the net: Update() of the
+// incremental tessellation against a full Tessellate. Both rows count every
+// sample as a point, so ns/point compares the latency of one drag step.
+//////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+void add_drag_curve(std::vector<Case>& cases, int k, int npts, int samples, bool incremental)
+{
+	auto raw = random_values<T>(npts * 3, npts * 67 + k);
+	auto curve = std::make_shared<nurbs::NurbsCurve<T>>(k, npts, raw->data());
+	auto inc = std::make_shared<nurbs::IncrementalCurve<T>>(*curve, samples);
+	auto out = std::make_shared<std::vector<T>>(samples * 3);
+	auto step = std::make_shared<int>(0);
+	const int i = npts / 2;
+
+	Case c;
+	c.kernel = incremental ? "drag IncrementalCurve::Update" : "drag NurbsCurve::Tessellate";
+	c.precision = precision_name<T>();
+	c.order = k;
+	c.npts = npts;
+	c.points = samples;
+	c.run = [=]() {
+		T p[3];
+		std::copy(raw->data() + i * 3, raw->data() + i * 3 + 3, p);
+		p[1] += T(0.01) * (++*step % 2);
+		if (incremental) {
+			inc->SetControlPoint(i, p);
+			inc->Update();
+		} else {
+			curve->SetControlPoint(i, p);
+			curve->Tessellate(samples, out->data());
+		}
+	};
+	// 0 when the buffer matches a full Tessellate of the dragged curve bit
+	// for bit, as both end in EvaluateSpan on the same basis rows
+	c.error = [=]() {
+		std::vector<T> ref(samples * 3);
+		if (incremental) {
+			inc->GetCurve().Tessellate(samples, ref.data());
+			return memcmp(ref.data(), inc->GetPoints(), ref.size() * sizeof(T)) != 0 ? 1.0 : 0.0;
+		}
+		nurbs::IncrementalCurve<T> full(*curve, samples);
+		return memcmp(full.GetPoints(), out->data(), ref.size() * sizeof(T)) != 0 ? 1.0 : 0.0;
+	};
+	c.tol = 0;
+	cases.push_back(c);
+}
+
+template <typename T>
+void add_drag_surface(std::vector<Case>& cases, int k, int npts, int p, bool incremental)
+{
+	auto raw = random_values<T>(npts * npts * 3, npts * 71 + k);
+	auto surface = std::make_shared<nurbs::NurbsSurface<T>>(k, k, npts, npts, raw->data());
+	auto inc = std::make_shared<nurbs::IncrementalSurface<T>>(*surface, p, p);
+	auto out = std::make_shared<std::vector<T>>(p * p * 3);
+	auto step = std::make_shared<int>(0);
+	const int i = npts / 2;
+
+	Case c;
+	c.kernel = incremental ? "drag IncrementalSurface::Update" : "drag NurbsSurface::Tessellate";
+	c.precision = precision_name<T>();
+	c.order = k;
+	c.npts = npts;
+	c.points = p * p;
+	c.run = [=]() {
+		T q[3];
+		std::copy(raw->data() + (i * npts + i) * 3, raw->data() + (i * npts + i) * 3 + 3, q);
+		q[2] += T(0.01) * (++*step % 2);
+		if (incremental) {
+			inc->SetControlPoint(i, i, q);
+			inc->Update();
+		} else {
+			surface->SetControlPoint(i, i, q);
+			surface->Tessellate(p, p, out->data());
+		}
+	};
+	c.error = [=]() {
+		std::vector<T> ref(p * p * 3);
+		if (incremental) {
+			inc->GetSurface().Tessellate(p, p, ref.data());
+			return memcmp(ref.data(), inc->GetPoints(), ref.size() * sizeof(T)) != 0 ? 1.0 : 0.0;
+		}
+		nurbs::IncrementalSurface<T> full(*surface, p, p);
+		return memcmp(full.GetPoints(), out->data(), ref.size() * sizeof(T)) != 0 ? 1.0 : 0.0;
+	};
+	c.tol = 0;
+	cases.push_back(c);
+}
+
+template <typename T>
+void add_drag_cases(std::vector<Case>& cases, const Sweep& s)
+{
+	const int k = s.orders.back();
+	for (int npts : s.npts) {
+		for (int incremental = 1; incremental >= 0; --incremental) {
+			add_drag_curve<T>(cases, k, npts, s.samples.back(), incremental != 0);
+		}
+	}
+	for (int npts : s.drag_npts) {
+		for (int incremental = 1; incremental >= 0; --incremental) {
+			add_drag_surface<T>(cases, s.surf_orders.back(), npts, s.surf_samples.back(), incremental != 0);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// closest point queries against the brute-force search of a dense
+// tessellation, on a noisy helix and a wavy height field. The curve rows
+// also run CurveProjector forced onto its tree and onto its scan: the two
+// cost the same at about 128 control points, the default scans curves of
+// up to PROJECT_DENSE_SPANS = 96 spans. Brute force only wins below about
+// 16 control points, and there it is off by up to 1e-2.
+//////////////////////////////////////////////////////////////////////////
+
+const int PROJECT_QUERIES = 1024;
+
+std::shared_ptr<std::vector<double>> random_queries(int count, unsigned seed)
+{
+	return random_values<double>(count * 3, seed, -1.5, 1.5);
+}
+
+std::shared_ptr<std::vector<double>> helix_points(int npts)
+{
+	auto noise = random_values<double>(npts * 3, npts * 29, -0.2, 0.2);
+	auto pts = std::make_shared<std::vector<double>>(npts * 3);
+	for (int i = 0; i < npts; ++i)
+	{
+		const double a = 6.0 * i / npts;
+		(*pts)[i * 3]     = cos(a) + (*noise)[i * 3];
+		(*pts)[i * 3 + 1] = sin(a) + (*noise)[i * 3 + 1];
+		(*pts)[i * 3 + 2] = -1 + 2.0 * i / npts + (*noise)[i * 3 + 2];
+	}
+	return pts;
+}
+
+std::shared_ptr<std::vector<double>> wave_points(int npts)
+{
+	auto noise = random_values<double>(npts * npts * 3, npts * 37, -1, 1);
+	auto pts = std::make_shared<std::vector<double>>(npts * npts * 3);
+	for (int i = 0; i < npts; ++i)
+	{
+		for (int j = 0; j < npts; ++j)
+		{
+			const double x = -1 + 2.0 * i / (npts - 1), y = -1 + 2.0 * j / (npts - 1);
+			double* p = &(*pts)[(i * npts + j) * 3];
+			const double* n = &(*noise)[(i * npts + j) * 3];
+			p[0] = x + 0.3 / npts * n[0];
+			p[1] = y + 0.3 / npts * n[1];
+			p[2] = 0.4 * sin(3 * x) * cos(2 * y) + 0.05 * n[2];
+		}
+	}
+	return pts;
+}
+
+// Excess of the found distances over the nearest of `ref` reference points,
+// which can only be at or above the true distance.
+template <typename Dist>
+double projection_error(const std::vector<double>& queries, const std::vector<real>& ref, Dist dist)
+{
+	const int count = static_cast<int>(queries.size() / 3);
+	real err = 0;
+	for (int q = 0; q < count; ++q)
+	{
+		const double* p = &queries[q * 3];
+		real nearest = std::numeric_limits<real>::max();
+		for (size_t i = 0; i < ref.size(); i += 3)
+		{
+			const real dx = ref[i] - p[0], dy = ref[i + 1] - p[1], dz = ref[i + 2] - p[2];
+			nearest = std::min(nearest, dx * dx + dy * dy + dz * dz);
+		}
+		err = std::max(err, static_cast<real>(dist(q)) - std::sqrt(nearest));
+	}
+	return static_cast<double>(err);
+}
+
+// variant: 0 brute force, 1 CurveProjector, 2 CurveProjector on the pool,
+// 3 and 4 CurveProjector always on its tree and always scanning
+template <typename T>
+void add_project_curve(std::vector<Case>& cases, int k, int npts, int variant)
+{
+	auto raw = helix_points(npts);
+	std::vector<T> pts(raw->begin(), raw->end());
+	const nurbs::NurbsCurve<T> curve(k, npts, pts.data());
+	auto queries = random_queries(PROJECT_QUERIES, npts + k);
+	auto tq = std::make_shared<std::vector<T>>(queries->begin(), queries->end());
+	auto results = std::make_shared<std::vector<nurbs::CurvePoint<T>>>(PROJECT_QUERIES);
+	auto dists = std::make_shared<std::vector<T>>(PROJECT_QUERIES);
+
+	static const char* NAMES[] = { "project curve(brute)", "CurveProjector", "CurveProjector(pool)",
+		"CurveProjector(tree)", "CurveProjector(scan)" };
+
+	Case c;
+	c.kernel = NAMES[variant];
+	c.precision = precision_name<T>();
+	c.order = k;
+	c.npts = npts;
+	c.points = PROJECT_QUERIES;
+	c.tol = tolerance<T>(1, 16);
+	if (variant == 0)
+	{
+		// what callers do without inversion: 32 points per span
+		const int samples = 32 * (npts - k + 1);
+		auto poly = std::make_shared<std::vector<T>>(samples * 3);
+		curve.Tessellate(samples, poly->data());
+		c.run = [=]() {
+			for (int q = 0; q < PROJECT_QUERIES; ++q)
+			{
+				const T* p = &(*tq)[q * 3];
+				T best = std::numeric_limits<T>::max();
+				for (int i = 0; i < samples; ++i)
+				{
+					const T* s = &(*poly)[i * 3];
+					const T dx = s[0] - p[0], dy = s[1] - p[1], dz = s[2] - p[2];
+					best = std::min(best, dx * dx + dy * dy + dz * dz);
+				}
+				(*dists)[q] = std::sqrt(best);
+			}
+		};
+		// the sampling error, reported only
+		c.tol = std::numeric_limits<double>::infinity();
+	}
+	else
+	{
+		auto projector = variant < 3 ? std::make_shared<nurbs::CurveProjector<T>>(curve)
+			: std::make_shared<nurbs::CurveProjector<T>>(curve, variant == 3 ? 0 : std::numeric_limits<int>::max());
+		c.run = [=]() {
+			if (variant != 2)
+			{
+				for (int q = 0; q < PROJECT_QUERIES; ++q) {
+					projector->Project(&(*tq)[q * 3], (*results)[q]);
+				}
+			}
+			else
+			{
+				projector->Project(tq->data(), PROJECT_QUERIES, results->data(), nurbs::ThreadPool::Instance());
+			}
+			for (int q = 0; q < PROJECT_QUERIES; ++q) {
+				(*dists)[q] = (*results)[q].dist;
+			}
+		};
+	}
+	c.error = [=]() {
+		auto params = oracle::stepped_params<double>(0, npts - k + 1, 16384);
+		auto ref = oracle::bspline(k, npts, oracle::open_knots(npts, k),
+			[&](int i, int d) -> real { return (*raw)[i * 3 + d]; }, oracle::CurveWeights(),
+			to_real(params), 3);
+		return projection_error(*queries, ref, [&](int q) { return (*dists)[q]; });
+	};
+	cases.push_back(c);
+}
+
+template <typename T>
+void add_project_surface(std::vector<Case>& cases, int k, int npts, int variant)
+{
+	const int queries_num = PROJECT_QUERIES / 4;
+	auto raw = wave_points(npts);
+	std::vector<T> pts(raw->begin(), raw->end());
+	const nurbs::NurbsSurface<T> surface(k, k, npts, npts, pts.data());
+	auto queries = random_queries(queries_num, npts * 3 + k);
+	auto tq = std::make_shared<std::vector<T>>(queries->begin(), queries->end());
+	auto results = std::make_shared<std::vector<nurbs::SurfacePoint<T>>>(queries_num);
+	auto dists = std::make_shared<std::vector<T>>(queries_num);
+
+	static const char* NAMES[] = { "project surface(brute)", "SurfaceProjector", "SurfaceProjector(pool)" };
+
+	Case c;
+	c.kernel = NAMES[variant];
+	c.precision = precision_name<T>();
+	c.order = k;
+	c.npts = npts;
+	c.points = queries_num;
+	c.tol = tolerance<T>(1, 16);
+	if (variant == 0)
+	{
+		// 16 x 16 points per patch
+		const int samples = 16 * (npts - k + 1);
+		auto grid = std::make_shared<std::vector<T>>(samples * samples * 3);
+		surface.Tessellate(samples, samples, grid->data());
+		c.run = [=]() {
+			for (int q = 0; q < queries_num; ++q)
+			{
+				const T* p = &(*tq)[q * 3];
+				T best = std::numeric_limits<T>::max();
+				for (int i = 0; i < samples * samples; ++i)
+				{
+					const T* s = &(*grid)[i * 3];
+					const T dx = s[0] - p[0], dy = s[1] - p[1], dz = s[2] - p[2];
+					best = std::min(best, dx * dx + dy * dy + dz * dz);
+				}
+				(*dists)[q] = std::sqrt(best);
+			}
+		};
+		c.tol = std::numeric_limits<double>::infinity();
+	}
+	else
+	{
+		auto projector = std::make_shared<nurbs::SurfaceProjector<T>>(surface);
+		c.run = [=]() {
+			if (variant == 1)
+			{
+				for (int q = 0; q < queries_num; ++q) {
+					projector->Project(&(*tq)[q * 3], (*results)[q]);
+				}
+			}
+			else
+			{
+				projector->Project(tq->data(), queries_num, results->data(), nurbs::ThreadPool::Instance());
+			}
+			for (int q = 0; q < queries_num; ++q) {
+				(*dists)[q] = (*results)[q].dist;
+			}
+		};
+	}
+	c.error = [=]() {
+		auto params = to_real(oracle::stepped_params<double>(0, npts - k + 1, 256));
+		auto knots = oracle::open_knots(npts, k);
+		auto ref = oracle::surface(k, k, npts, npts, knots, knots,
+			[&](int i, int j, int d) -> real { return (*raw)[(i * npts + j) * 3 + d]; },
+			oracle::SurfaceWeights(), params, params);
+		return projection_error(*queries, ref, [&](int q) { return (*dists)[q]; });
+	};
+	cases.push_back(c);
+}
+
+template <typename T>
+void add_project_cases(std::vector<Case>& cases, const Sweep& s)
+{
+	for (int k : s.orders) {
+		for (int npts : s.project_npts) {
+			for (int variant = 0; variant < 5; ++variant) {
+				if (npts >= k) {
+					add_project_curve<T>(cases, k, npts, variant);
+				}
+			}
+		}
+	}
+	for (int k : s.surf_orders) {
+		for (int npts : s.surf_npts) {
+			for (int variant = 0; variant < 3; ++variant) {
+				add_project_surface<T>(cases, k, npts, variant);
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// NurbsSurface::Tessellate on a net far larger than the sweep's, with and
+// without weights
+//////////////////////////////////////////////////////////////////////////
+
+const int LARGE_NET = 200;
+
+template <typename T>
+void add_surface_tessellate(std::vector<Case>& cases, int k, int npts, int p, bool rational)
+{
+	auto raw = random_values<double>(npts * npts * 3, npts * 59 + k);
+	auto h = random_values<double>(npts * npts, npts * 61 + k, 0.5, 2.0);
+	std::vector<T> pts(raw->begin(), raw->end()), weights(h->begin(), h->end());
+	auto surface = std::make_shared<nurbs::NurbsSurface<T>>(k, k, npts, npts, pts.data(),
+		rational ? weights.data() : nullptr);
+	auto out = std::make_shared<std::vector<T>>(p * p * 3);
+
+	Case c;
+	c.kernel = rational ? "NurbsSurface::Tessellate(w)" : "NurbsSurface::Tessellate";
+	c.precision = precision_name<T>();
+	c.order = k;
+	c.npts = npts;
+	c.points = p * p;
+	c.run = [=]() {
+		surface->Tessellate(p, p, out->data());
+	};
+
+	const int range = npts - k + 1;
+	c.error = [=]() {
+		std::vector<real> params(p);
+		for (int i = 0; i < p; ++i) {
+			params[i] = static_cast<real>(static_cast<T>(i == p - 1 ? range : T(range) * i / (p - 1)));
+		}
+		auto knots = oracle::open_knots(npts, k);
+		oracle::SurfaceWeights sw;
+		if (rational) {
+			sw = [&](int i, int j) -> real { return static_cast<T>((*h)[i * npts + j]); };
+		}
+		auto ref = oracle::surface(k, k, npts, npts, knots, knots,
+			[&](int i, int j, int d) -> real { return static_cast<T>((*raw)[(i * npts + j) * 3 + d]); },
+			sw, params, params);
+		return oracle::max_error(out->data(), 3, 3, ref);
+	};
+	c.tol = tolerance<T>(range, 2);
+	cases.push_back(c);
+}
+
+template <typename T>
+void add_surface_cases(std::vector<Case>& cases, const Sweep& s)
+{
+	for (int k : s.surf_orders) {
+		for (int rational = 0; rational < 2; ++rational) {
+			add_surface_tessellate<T>(cases, k, LARGE_NET, s.surf_samples.back(), rational != 0);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// derivatives, normals and vertex buffers against the quotient rule on the
+// oracle's differentiated basis, second derivatives throughout
+//////////////////////////////////////////////////////////////////////////
+
+const int DERIV_ORDER = 2;
+
+// params as Tessellate steps them
+template <typename T>
+std::vector<real> domain_params(T t0, T t1, int samples)
+{
+	std::vector<real> t(samples);
+	for (int i = 0; i < samples; ++i) {
+		t[i] = static_cast<real>(i == samples - 1 ? t1 : t0 + (t1 - t0) * i / (samples - 1));
+	}
+	return t;
+}
+
+// variant 0 Derivatives per sample, 1 TessellateDerivs
+template <typename T>
+void add_curve_derivs(std::vector<Case>& cases, int k, int npts, int samples, bool rational, int variant)
+{
+	auto raw = random_values<double>(npts * 3, npts * 73 + k);
+	auto h = random_values<double>(npts, npts * 79 + k, 0.5, 2.0);
+	std::vector<T> pts(raw->begin(), raw->end()), weights(h->begin(), h->end());
+	auto curve = std::make_shared<nurbs::NurbsCurve<T>>(k, npts, pts.data(), rational ? weights.data() : nullptr);
+	auto out = std::make_shared<std::vector<T>>(samples * (DERIV_ORDER + 1) * 3);
+	T t0, t1;
+	curve->GetDomain(t0, t1);
+	const auto params = domain_params(t0, t1, samples);
+
+	static const char* NAMES[2][2] = {
+		{ "NurbsCurve::Derivatives", "NurbsCurve::TessellateDerivs" },
+		{ "NurbsCurve::Derivatives(w)", "NurbsCurve::TessellateDerivs(w)" },
+	};
+	Case c;
+	c.kernel = NAMES[rational][variant];
+	c.precision = precision_name<T>();
+	c.order = k;
+	c.npts = npts;
+	c.points = samples;
+	if (variant == 0)
+	{
+		auto t = std::make_shared<std::vector<T>>(params.begin(), params.end());
+		c.run = [=]() {
+			for (int i = 0; i < samples; ++i) {
+				curve->Derivatives((*t)[i], DERIV_ORDER, out->data() + i * (DERIV_ORDER + 1) * 3);
+			}
+		};
+	}
+	else
+	{
+		c.run = [=]() {
+			curve->TessellateDerivs(samples, DERIV_ORDER, out->data());
+		};
+	}
+	c.error = [=]() {
+		oracle::CurveWeights cw;
+		if (rational) {
+			cw = [&](int i) -> real { return static_cast<T>((*h)[i]); };
+		}
+		auto ref = oracle::bspline_derivs(k, npts, oracle::open_knots(npts, k),
+			[&](int i, int d) -> real { return static_cast<T>((*raw)[i * 3 + d]); }, cw, params, DERIV_ORDER);
+		return oracle::max_error(out->data(), 3, 3, ref);
+	};
+	// each derivative scales the rounding by about k times the knot density
+	c.tol = tolerance<T>(npts - k + 1, k * k);
+	cases.push_back(c);
+}
+
+// variant 0 Derivatives per point, 1 Normal, 2 TessellateVertices of every
+// attribute
+template <typename T>
+void add_surface_derivs(std::vector<Case>& cases, int k, int npts, int p, bool rational, int variant)
+{
+	const int d1 = DERIV_ORDER + 1;
+	const int format = nurbs::SURF_POSITION | nurbs::SURF_NORMAL | nurbs::SURF_DU | nurbs::SURF_DW
+		| nurbs::SURF_DUU | nurbs::SURF_DUW | nurbs::SURF_DWW;
+	const int size = variant == 0 ? d1 * d1 * 3 : (variant == 1 ? 3 : nurbs::NurbsSurface<T>::GetVertexSize(format));
+
+	auto raw = random_values<double>(npts * npts * 3, npts * 83 + k);
+	auto h = random_values<double>(npts * npts, npts * 89 + k, 0.5, 2.0);
+	std::vector<T> pts(raw->begin(), raw->end()), weights(h->begin(), h->end());
+	auto surface = std::make_shared<nurbs::NurbsSurface<T>>(k, k, npts, npts, pts.data(),
+		rational ? weights.data() : nullptr);
+	auto out = std::make_shared<std::vector<T>>(p * p * size);
+	T t0, t1;
+	surface->GetDomainU(t0, t1);
+	const auto params = domain_params(t0, t1, p);
+	auto t = std::make_shared<std::vector<T>>(params.begin(), params.end());
+
+	static const char* NAMES[2][3] = {
+		{ "NurbsSurface::Derivatives", "NurbsSurface::Normal", "NurbsSurface::TessellateVertices" },
+		{ "NurbsSurface::Derivatives(w)", "NurbsSurface::Normal(w)", "NurbsSurface::TessellateVertices(w)" },
+	};
+	Case c;
+	c.kernel = NAMES[rational][variant];
+	c.precision = precision_name<T>();
+	c.order = k;
+	c.npts = npts;
+	c.points = p * p;
+	c.run = [=]() {
+		if (variant == 2) {
+			surface->TessellateVertices(p, p, format, out->data());
+			return;
+		}
+		T* dst = out->data();
+		for (int iu = 0; iu < p; ++iu)
+		{
+			for (int iw = 0; iw < p; ++iw)
+			{
+				if (variant == 0) {
+					surface->Derivatives((*t)[iu], (*t)[iw], DERIV_ORDER, dst);
+				} else {
+					surface->Normal((*t)[iu], (*t)[iw], dst);
+				}
+				dst += size;
+			}
+		}
+	};
+	c.error = [=]() {
+		oracle::SurfaceWeights sw;
+		if (rational) {
+			sw = [&](int i, int j) -> real { return static_cast<T>((*h)[i * npts + j]); };
+		}
+		auto knots = oracle::open_knots(npts, k);
+		auto skl = oracle::surface_derivs(k, k, npts, npts, knots, knots,
+			[&](int i, int j, int d) -> real { return static_cast<T>((*raw)[(i * npts + j) * 3 + d]); },
+			sw, params, params, DERIV_ORDER);
+
+		// reference in the layout of out: the partials with a + b <= 2, the
+		// unit normal, or the vertex attributes in SurfaceVertex order
+		static const int PARTIALS[][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 2, 0 }, { 1, 1 }, { 0, 2 } };
+		std::vector<real> ref;
+		std::vector<T> got;
+		for (int s = 0; s < p * p; ++s)
+		{
+			const real* r = &skl[s * d1 * d1 * 3];
+			const T* o = &(*out)[s * size];
+			auto partial = [&](int a, int b) {
+				ref.insert(ref.end(), r + (a * d1 + b) * 3, r + (a * d1 + b) * 3 + 3);
+			};
+			auto normal = [&]() {
+				const real* su = r + d1 * 3;
+				const real* sw = r + 3;
+				const real n[3] = { su[1] * sw[2] - su[2] * sw[1], su[2] * sw[0] - su[0] * sw[2],
+					su[0] * sw[1] - su[1] * sw[0] };
+				const real len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				for (int e = 0; e < 3; ++e) {
+					ref.push_back(len > 0 ? n[e] / len : 0);
+				}
+			};
+			if (variant == 0)
+			{
+				for (auto& ab : PARTIALS) {
+					partial(ab[0], ab[1]);
+					got.insert(got.end(), o + (ab[0] * d1 + ab[1]) * 3, o + (ab[0] * d1 + ab[1]) * 3 + 3);
+				}
+			}
+			else if (variant == 1)
+			{
+				normal();
+				got.insert(got.end(), o, o + 3);
+			}
+			else
+			{
+				partial(0, 0);
+				normal();
+				for (int a = 1; a < 6; ++a) {
+					partial(PARTIALS[a][0], PARTIALS[a][1]);
+				}
+				got.insert(got.end(), o, o + size);
+			}
+		}
+		return oracle::max_error(got.data(), 3, 3, ref);
+	};
+	c.tol = tolerance<T>(npts - k + 1, k * k);
+	cases.push_back(c);
+}
+
+template <typename T>
+void add_derivs_cases(std::vector<Case>& cases, const Sweep& s)
+{
+	for (int k : s.orders) {
+		for (int npts : s.npts) {
+			for (int rational = 0; rational < 2; ++rational) {
+				for (int variant = 0; variant < 2; ++variant) {
+					add_curve_derivs<T>(cases, k, npts, s.samples.front(), rational != 0, variant);
+				}
+			}
+		}
+	}
+	for (int k : s.surf_orders) {
+		for (int rational = 0; rational < 2; ++rational) {
+			for (int variant = 0; variant < 3; ++variant) {
+				add_surface_derivs<T>(cases, k, s.surf_npts.back(), s.surf_samples.front(), rational != 0, variant);
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// TessellateAdaptive against the uniform Tessellate with the fewest points
+// whose measured chord error is no larger. points is the vertex count, so
+// points times ns/point is the time per tessellation; the error column is
+// the measured chord error.
+//////////////////////////////////////////////////////////////////////////
+
+double distance(const double* a, const double* b)
+{
+	double d2 = 0;
+	for (int c = 0; c < 3; ++c) {
+		d2 += (a[c] - b[c]) * (a[c] - b[c]);
+	}
+	return std::sqrt(d2);
+}
+
+double segment_distance(const double* p, const double* a, const double* b)
+{
+	double ab[3], ap[3];
+	for (int c = 0; c < 3; ++c) {
+		ab[c] = b[c] - a[c];
+		ap[c] = p[c] - a[c];
+	}
+	const double len2 = ab[0] * ab[0] + ab[1] * ab[1] + ab[2] * ab[2];
+	double s = len2 > 0 ? (ap[0] * ab[0] + ap[1] * ab[1] + ap[2] * ab[2]) / len2 : 0;
+	s = s < 0 ? 0 : (s > 1 ? 1 : s);
+	const double q[3] = { a[0] + s * ab[0], a[1] + s * ab[1], a[2] + s * ab[2] };
+	return distance(p, q);
+}
+
+// closest point on triangle abc by its Voronoi regions (Ericson,
+// Real-Time Collision Detection 5.1.5)
+double triangle_distance(const double* p, const double* a, const double* b, const double* c)
+{
+	double ab[3], ac[3], ap[3], bp[3], cp[3];
+	for (int i = 0; i < 3; ++i) {
+		ab[i] = b[i] - a[i];
+		ac[i] = c[i] - a[i];
+		ap[i] = p[i] - a[i];
+		bp[i] = p[i] - b[i];
+		cp[i] = p[i] - c[i];
+	}
+	auto dot = [](const double* x, const double* y) { return x[0] * y[0] + x[1] * y[1] + x[2] * y[2]; };
+	const double d1 = dot(ab, ap), d2 = dot(ac, ap);
+	const double d3 = dot(ab, bp), d4 = dot(ac, bp);
+	const double d5 = dot(ab, cp), d6 = dot(ac, cp);
+	const double va = d3 * d6 - d5 * d4, vb = d5 * d2 - d1 * d6, vc = d1 * d4 - d3 * d2;
+	if (d1 <= 0 && d2 <= 0) {
+		return distance(p, a);
+	}
+	if (d3 >= 0 && d4 <= d3) {
+		return distance(p, b);
+	}
+	if (d6 >= 0 && d5 <= d6) {
+		return distance(p, c);
+	}
+	if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+		return segment_distance(p, a, b);
+	}
+	if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+		return segment_distance(p, a, c);
+	}
+	if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+		return segment_distance(p, b, c);
+	}
+	const double v = vb / (va + vb + vc), w = vc / (va + vb + vc);
+	double q[3];
+	for (int i = 0; i < 3; ++i) {
+		q[i] = a[i] + ab[i] * v + ac[i] * w;
+	}
+	return distance(p, q);
+}
+
+// Max distance of the curve from the polyline: points sampled between the
+// params of each segment against it and its two neighbours, so a point
+// that drifts along the curve is not counted as error.
+double polyline_error(const nurbs::NurbsCurve<double>& curve, const std::vector<double>& params,
+	                  const std::vector<double>& points)
+{
+	const int SUB = 8;
+	const int n = static_cast<int>(params.size());
+	double err = 0;
+	for (int i = 0; i + 1 < n; ++i)
+	{
+		for (int s = 1; s < SUB; ++s)
+		{
+			double p[3];
+			curve.Evaluate(params[i] + (params[i + 1] - params[i]) * s / SUB, p);
+			double best = segment_distance(p, &points[i * 3], &points[(i + 1) * 3]);
+			if (i > 0) {
+				best = std::min(best, segment_distance(p, &points[(i - 1) * 3], &points[i * 3]));
+			}
+			if (i + 2 < n) {
+				best = std::min(best, segment_distance(p, &points[(i + 1) * 3], &points[(i + 2) * 3]));
+			}
+			err = std::max(err, best);
+		}
+	}
+	return err;
+}
+
+// The same for a mesh: points sampled in the param triangle of each
+// triangle against every triangle around its vertices.
+double mesh_error(const nurbs::NurbsSurface<double>& surface, const nurbs::AdaptiveMesh<double>& mesh)
+{
+	const int SUB = 4;
+	const int ntris = mesh.GetTriangleNum();
+	std::vector<std::vector<int>> ring(mesh.GetVertexNum());
+	for (int t = 0; t < ntris; ++t) {
+		for (int c = 0; c < 3; ++c) {
+			ring[mesh.triangles[t * 3 + c]].push_back(t);
+		}
+	}
+
+	double err = 0;
+	std::vector<int> near;
+	for (int t = 0; t < ntris; ++t)
+	{
+		const int* v = &mesh.triangles[t * 3];
+		near.clear();
+		for (int c = 0; c < 3; ++c) {
+			near.insert(near.end(), ring[v[c]].begin(), ring[v[c]].end());
+		}
+		for (int i = 0; i <= SUB; ++i)
+		{
+			for (int j = 0; i + j <= SUB; ++j)
+			{
+				const double a = double(i) / SUB, b = double(j) / SUB, c = 1 - a - b;
+				const double u = a * mesh.params[v[0] * 2] + b * mesh.params[v[1] * 2] + c * mesh.params[v[2] * 2];
+				const double w = a * mesh.params[v[0] * 2 + 1] + b * mesh.params[v[1] * 2 + 1]
+					+ c * mesh.params[v[2] * 2 + 1];
+				double p[3];
+				surface.Evaluate(u, w, p);
+				double best = std::numeric_limits<double>::max();
+				for (int q : near) {
+					const int* x = &mesh.triangles[q * 3];
+					best = std::min(best, triangle_distance(p, &mesh.points[x[0] * 3],
+						&mesh.points[x[1] * 3], &mesh.points[x[2] * 3]));
+				}
+				err = std::max(err, best);
+			}
+		}
+	}
+	return err;
+}
+
+// evenly spaced params over [t0, t1], the last exactly t1 as in Tessellate
+std::vector<double> uniform_params(double t0, double t1, int samples)
+{
+	std::vector<double> t(samples);
+	for (int i = 0; i < samples; ++i) {
+		t[i] = i == samples - 1 ? t1 : t0 + (t1 - t0) * i / (samples - 1);
+	}
+	return t;
+}
+
+double uniform_error(const nurbs::NurbsCurve<double>& curve, int samples)
+{
+	double t0, t1;
+	curve.GetDomain(t0, t1);
+	std::vector<double> points(samples * 3);
+	curve.Tessellate(samples, points.data());
+	return polyline_error(curve, uniform_params(t0, t1, samples), points);
+}
+
+// p x p grid of Tessellate, each cell cut along the same diagonal as the
+// adaptive grids
+double uniform_error(const nurbs::NurbsSurface<double>& surface, int p)
+{
+	double u0, u1, w0, w1;
+	surface.GetDomainU(u0, u1);
+	surface.GetDomainW(w0, w1);
+	const std::vector<double> us = uniform_params(u0, u1, p), ws = uniform_params(w0, w1, p);
+	nurbs::AdaptiveMesh<double> mesh;
+	mesh.points.resize(p * p * 3);
+	surface.Tessellate(p, p, mesh.points.data());
+	for (int i = 0; i < p; ++i)
+	{
+		for (int j = 0; j < p; ++j)
+		{
+			mesh.params.push_back(us[i]);
+			mesh.params.push_back(ws[j]);
+			if (i + 1 < p && j + 1 < p) {
+				const int a = i * p + j;
+				const int tris[6] = { a, a + p, a + p + 1, a, a + p + 1, a + 1 };
+				mesh.triangles.insert(mesh.triangles.end(), tris, tris + 6);
+			}
+		}
+	}
+	return mesh_error(surface, mesh);
+}
+
+// fewest samples (per direction for surfaces) whose uniform error is
+// within err, by doubling then bisecting
+template <typename Shape>
+int matched_samples(const Shape& shape, double err)
+{
+	int lo = 2, hi = 2;
+	while (uniform_error(shape, hi) > err) {
+		lo = hi;
+		hi *= 2;
+	}
+	while (hi - lo > 1)
+	{
+		const int mid = (lo + hi) / 2;
+		if (uniform_error(shape, mid) > err) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+	return hi;
+}
+
+// Midpoint and quarter point tests bound the error at the tested params,
+// not between them, and a surface border follows its boundary curve alone,
+// so a fine grid row can fan out to one long border segment; the measured
+// error stays within this factor of chord.
+const double ADAPTIVE_SLACK = 4;
+
+void add_adaptive_curve(std::vector<Case>& cases, const char* name, std::shared_ptr<nurbs::NurbsCurve<double>> curve,
+	                    double chord)
+{
+	nurbs::AdaptiveTolerance tol;
+	tol.chord = chord;
+	tol.angle = 0;
+	auto params = std::make_shared<std::vector<double>>();
+	auto points = std::make_shared<std::vector<double>>();
+	curve->TessellateAdaptive(tol, *params, *points);
+	const double err = polyline_error(*curve, *params, *points);
+	const int samples = matched_samples(*curve, err);
+	auto out = std::make_shared<std::vector<double>>(samples * 3);
+
+	Case c;
+	c.kernel = std::string(name) + " NurbsCurve::TessellateAdaptive";
+	c.precision = precision_name<double>();
+	c.order = curve->GetOrder();
+	c.npts = curve->GetNum();
+	c.points = static_cast<int>(params->size());
+	c.run = [=]() {
+		curve->TessellateAdaptive(tol, *params, *points);
+	};
+	c.error = [=]() {
+		return polyline_error(*curve, *params, *points);
+	};
+	c.tol = chord * ADAPTIVE_SLACK;
+	cases.push_back(c);
+
+	c.kernel = std::string(name) + " NurbsCurve::Tessellate(matched)";
+	c.points = samples;
+	c.run = [=]() {
+		curve->Tessellate(samples, out->data());
+	};
+	c.error = [=]() {
+		return uniform_error(*curve, samples);
+	};
+	c.tol = err;
+	cases.push_back(c);
+}
+
+void add_adaptive_surface(std::vector<Case>& cases, const char* name,
+	                      std::shared_ptr<nurbs::NurbsSurface<double>> surface, double chord)
+{
+	nurbs::AdaptiveTolerance tol;
+	tol.chord = chord;
+	tol.angle = 0;
+	auto mesh = std::make_shared<nurbs::AdaptiveMesh<double>>();
+	surface->TessellateAdaptive(tol, *mesh);
+	const double err = mesh_error(*surface, *mesh);
+	const int p = matched_samples(*surface, err);
+	auto out = std::make_shared<std::vector<double>>(p * p * 3);
+
+	Case c;
+	c.kernel = std::string(name) + " NurbsSurface::TessellateAdaptive";
+	c.precision = precision_name<double>();
+	c.order = surface->GetOrderU();
+	c.npts = surface->GetNumU();
+	c.points = mesh->GetVertexNum();
+	c.run = [=]() {
+		surface->TessellateAdaptive(tol, *mesh);
+	};
+	c.error = [=]() {
+		return mesh_error(*surface, *mesh);
+	};
+	c.tol = chord * ADAPTIVE_SLACK;
+	cases.push_back(c);
+
+	c.kernel = std::string(name) + " NurbsSurface::Tessellate(matched)";
+	c.points = p * p;
+	c.run = [=]() {
+		surface->Tessellate(p, p, out->data());
+	};
+	c.error = [=]() {
+		return uniform_error(*surface, p);
+	};
+	c.tol = err;
+	cases.push_back(c);
+}
+
+// A net of random heights, where the curvature is spread evenly and a
+// uniform grid is hard to beat, the same net flat but for one corner, and
+// the rational quarter cylinder, where the adaptive grid follows the arc
+// and leaves the straight direction alone.
+void add_adaptive_cases(std::vector<Case>& cases)
+{
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<double> height(-1, 1);
+
+	const int CURVE_NPTS = 32;
+	std::vector<double> wave(CURVE_NPTS * 3), bump(CURVE_NPTS * 3);
+	for (int i = 0; i < CURVE_NPTS; ++i)
+	{
+		wave[i * 3] = bump[i * 3] = i;
+		wave[i * 3 + 1] = height(rng);
+		bump[i * 3 + 1] = i > CURVE_NPTS - 6 ? height(rng) : 0;
+		wave[i * 3 + 2] = bump[i * 3 + 2] = 0;
+	}
+	add_adaptive_curve(cases, "wave", std::make_shared<nurbs::NurbsCurve<double>>(4, CURVE_NPTS, wave.data()), 1e-3);
+	add_adaptive_curve(cases, "bump", std::make_shared<nurbs::NurbsCurve<double>>(4, CURVE_NPTS, bump.data()), 1e-3);
+	const auto circle = circle_net();
+	const auto h = circle_weights();
+	static const double KNOTS[CIRCLE_NPTS + 3] = { 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 4 };
+	add_adaptive_curve(cases, "circle", std::make_shared<nurbs::NurbsCurve<double>>(3, CIRCLE_NPTS,
+		circle.data(), h.data(), KNOTS), 1e-3);
+
+	const int NU = 6, NW = 5;
+	std::vector<double> random(NU * NW * 3);
+	for (int i = 0; i < NU; ++i)
+	{
+		for (int j = 0; j < NW; ++j)
+		{
+			random[(i * NW + j) * 3] = i;
+			random[(i * NW + j) * 3 + 1] = j;
+			random[(i * NW + j) * 3 + 2] = height(rng);
+		}
+	}
+	auto waves = std::make_shared<nurbs::NurbsSurface<double>>(4, 4, NU, NW, random.data());
+	add_adaptive_surface(cases, "wave", waves, 1e-3);
+	add_adaptive_surface(cases, "wave", waves, 1e-2);
+
+	const int NB = 20;
+	std::vector<double> corner(NB * NB * 3);
+	for (int i = 0; i < NB; ++i)
+	{
+		for (int j = 0; j < NB; ++j)
+		{
+			corner[(i * NB + j) * 3] = i;
+			corner[(i * NB + j) * 3 + 1] = j;
+			corner[(i * NB + j) * 3 + 2] = i > NB - 8 && j > NB - 8 ? height(rng) : 0;
+		}
+	}
+	add_adaptive_surface(cases, "bump", std::make_shared<nurbs::NurbsSurface<double>>(4, 4, NB, NB,
+		corner.data()), 1e-2);
+
+	// quadratic quarter arc in u swept straight along z in w
+	const int NZ = 8;
+	static const double ARC[3][2] = { { 1, 0 }, { 1, 1 }, { 0, 1 } };
+	static const double ARC_KNOTS[6] = { 0, 0, 0, 1, 1, 1 };
+	std::vector<double> cyl(3 * NZ * 3), cyl_h(3 * NZ);
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < NZ; ++j)
+		{
+			cyl[(i * NZ + j) * 3] = ARC[i][0];
+			cyl[(i * NZ + j) * 3 + 1] = ARC[i][1];
+			cyl[(i * NZ + j) * 3 + 2] = j * 0.5;
+			cyl_h[i * NZ + j] = i == 1 ? std::sqrt(0.5) : 1.0;
+		}
+	}
+	add_adaptive_surface(cases, "cylinder", std::make_shared<nurbs::NurbsSurface<double>>(3, 4, 3, NZ,
+		cyl.data(), cyl_h.data(), ARC_KNOTS), 1e-3);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// rational B-splines evaluated at the same params point by point and from
+// their extracted Bezier form, and the cost of re-extracting
+//////////////////////////////////////////////////////////////////////////
+
+// per samples evenly spaced over each unit span of an open knot vector
+std::vector<real> segment_params(int segments, int per)
+{
+	std::vector<real> t;
+	for (int s = 0; s < segments; ++s) {
+		for (int i = 0; i < per; ++i) {
+			t.push_back(i == per - 1 ? s + 1 : s + static_cast<real>(i) / (per - 1));
+		}
+	}
+	return t;
+}
+
+// variant: 0 NurbsCurve::Evaluate, 1 BezierSegments::Evaluate,
+// 2 BezierSegments::Extract with the knots unchanged
+template <typename T>
+void add_extract_curve(std::vector<Case>& cases, int k, int npts, int samples, int variant)
+{
+	auto raw = random_values<double>(npts * 3, npts * 41 + k);
+	auto h = random_values<double>(npts, npts * 43 + k, 0.5, 2.0);
+	std::vector<T> pts(raw->begin(), raw->end()), weights(h->begin(), h->end());
+	auto curve = std::make_shared<nurbs::NurbsCurve<T>>(k, npts, pts.data(), weights.data());
+	auto segments = std::make_shared<nurbs::BezierSegments<T>>(*curve);
+	const int num = npts - k + 1;
+	const int per = std::max(2, samples / num);
+	auto out = std::make_shared<std::vector<T>>(num * per * 3);
+	auto params = segment_params(num, per);
+
+	static const char* NAMES[] = { "NurbsCurve::Evaluate", "BezierSegments::Evaluate",
+		"BezierSegments::Extract" };
+
+	Case c;
+	c.kernel = NAMES[variant];
+	c.precision = precision_name<T>();
+	c.order = k;
+	c.npts = npts;
+	c.points = variant == 2 ? num * k : num * per;
+	c.run = [=]() {
+		switch (variant)
+		{
+		case 0:
+			for (size_t i = 0; i < params.size(); ++i) {
+				curve->Evaluate(static_cast<T>(params[i]), &(*out)[i * 3]);
+			}
+			break;
+		case 1:
+			segments->Evaluate(per, out->data());
+			break;
+		default:
+			segments->Extract(*curve);
+			break;
+		}
+	};
+	c.error = [=]() {
+		if (variant == 2) {
+			segments->Evaluate(per, out->data());
+		}
+		auto ref = oracle::bspline(k, npts, oracle::open_knots(npts, k),
+			[&](int i, int d) -> real { return (*raw)[i * 3 + d]; },
+			[&](int i) -> real { return (*h)[i]; }, params, 3);
+		return oracle::max_error(out->data(), 3, 3, ref);
+	};
+	c.tol = tolerance<T>(num);
+	cases.push_back(c);
+}
+
+template <typename T>
+void add_extract_surface(std::vector<Case>& cases, int k, int npts, int p, int variant)
+{
+	auto raw = random_values<double>(npts * npts * 3, npts * 47 + k);
+	auto h = random_values<double>(npts * npts, npts * 53 + k, 0.5, 2.0);
+	std::vector<T> pts(raw->begin(), raw->end()), weights(h->begin(), h->end());
+	auto surface = std::make_shared<nurbs::NurbsSurface<T>>(k, k, npts, npts, pts.data(), weights.data());
+	auto patches = std::make_shared<nurbs::BezierPatches<T>>(*surface);
+	const int num = npts - k + 1;
+	const int per = std::max(2, p / num);
+	auto out = std::make_shared<std::vector<T>>(num * num * per * per * 3);
+	auto params = segment_params(num, per);
+
+	static const char* NAMES[] = { "NurbsSurface::Evaluate", "BezierPatches::Evaluate",
+		"BezierPatches::Extract" };
+
+	Case c;
+	c.kernel = NAMES[variant];
+	c.precision = precision_name<T>();
+	c.order = k;
+	c.npts = npts;
+	c.points = variant == 2 ? num * num * k * k : num * num * per * per;
+	// both write patch by patch, per x per points each
+	c.run = [=]() {
+		switch (variant)
+		{
+		case 0:
+			for (int su = 0; su < num; ++su) {
+				for (int sw = 0; sw < num; ++sw) {
+					for (int iu = 0; iu < per; ++iu) {
+						for (int iw = 0; iw < per; ++iw) {
+							const int i = ((su * num + sw) * per + iu) * per + iw;
+							surface->Evaluate(static_cast<T>(params[su * per + iu]),
+								static_cast<T>(params[sw * per + iw]), &(*out)[i * 3]);
+						}
+					}
+				}
+			}
+			break;
+		case 1:
+			patches->Evaluate(per, per, out->data());
+			break;
+		default:
+			patches->Extract(*surface);
+			break;
+		}
+	};
+	c.error = [=]() {
+		if (variant == 2) {
+			patches->Evaluate(per, per, out->data());
+		}
+		auto knots = oracle::open_knots(npts, k);
+		auto ref = oracle::surface(k, k, npts, npts, knots, knots,
+			[&](int i, int j, int d) -> real { return (*raw)[(i * npts + j) * 3 + d]; },
+			[&](int i, int j) -> real { return (*h)[i * npts + j]; }, params, params);
+		// the reference is one grid over all patches
+		const int side = num * per;
+		std::vector<T> grid(side * side * 3);
+		for (int su = 0; su < num; ++su) {
+			for (int sw = 0; sw < num; ++sw) {
+				for (int iu = 0; iu < per; ++iu) {
+					for (int iw = 0; iw < per; ++iw) {
+						const int i = ((su * num + sw) * per + iu) * per + iw;
+						const int g = (su * per + iu) * side + sw * per + iw;
+						std::copy(&(*out)[i * 3], &(*out)[i * 3] + 3, &grid[g * 3]);
+					}
+				}
+			}
+		}
+		return oracle::max_error(grid.data(), 3, 3, ref);
+	};
+	c.tol = tolerance<T>(num, 2);
+	cases.push_back(c);
+}
+
+template <typename T>
+void add_extract_cases(std::vector<Case>& cases, const Sweep& s)
+{
+	for (int k : s.orders) {
+		for (int npts : s.npts) {
+			for (int p1 : s.samples) {
+				// extraction does not depend on the samples
+				const int variants = p1 == s.samples.front() ? 3 : 2;
+				for (int variant = 0; variant < variants; ++variant) {
+					if (npts >= k) {
+						add_extract_curve<T>(cases, k, npts, p1, variant);
+					}
+				}
+			}
+		}
+	}
+	for (int k : s.surf_orders) {
+		for (int npts : s.surf_npts) {
+			for (int p : s.surf_samples) {
+				const int variants = p == s.surf_samples.front() ? 3 : 2;
+				for (int variant = 0; variant < variants; ++variant) {
+					add_extract_surface<T>(cases, k, npts, p, variant);
+				}
+			}
+		}
+	}
+}
+
+struct Result
+{
+	double ns_per_point;
+	double allocs;
+	double misses;		// < 0 when not available
+};
+
+Result measure(const Case& c, double min_time, PerfCounter& perf)
+{
+	typedef std::chrono::steady_clock clock;
+
+	long long iters = 1;
+	while (true)
+	{
+		const long long allocs = alloc_count();
+		perf.Start();
+		const auto start = clock::now();
+		for (long long i = 0; i < iters; ++i) {
+			c.run();
+		}
+		const double sec = std::chrono::duration<double>(clock::now() - start).count();
+		const long long misses = perf.Stop();
+
+		if (sec >= min_time || iters >= (1LL << 40))
+		{
+			Result r;
+			r.ns_per_point = sec * 1e9 / (static_cast<double>(iters) * c.points);
+			r.allocs = static_cast<double>(alloc_count() - allocs) / iters;
+			r.misses = misses >= 0 ? static_cast<double>(misses) / iters : -1;
+			return r;
+		}
+
+		// aim a little past min_time in one more round
+		long long next = sec > 0 ? static_cast<long long>(iters * min_time * 1.2 / sec) : iters * 10;
+		iters = next > iters * 10 ? iters * 10 : (next > iters ? next : iters * 2);
+	}
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	bool quick = false, check = true, csv = false;
+	double min_time = 0.05;
+	std::string filter;
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		if (strcmp(arg, "--quick") == 0) {
+			quick = true;
+		} else if (strcmp(arg, "--no-check") == 0) {
+			check = false;
+		} else if (strcmp(arg, "--csv") == 0) {
+			csv = true;
+		} else if (strncmp(arg, "--filter=", 9) == 0) {
+			filter = arg + 9;
+		} else if (strncmp(arg, "--min-time=", 11) == 0) {
+			min_time = atof(arg + 11) / 1000.0;
+		} else {
+			fprintf(stderr, "usage: %s [--quick] [--filter=text] [--min-time=ms] [--no-check] [--csv]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	const Sweep sweep = quick ? quick_sweep() : full_sweep();
+	std::vector<Case> cases;
+	add_aitn_cases<float>(cases, sweep);
+	add_aitn_cases<double>(cases, sweep);
+	add_nurbs_cases(cases, sweep);
+	add_circle_cases(cases, sweep);
+	add_batch_cases(cases, sweep);
+	add_tessellate_cases(cases, sweep);
+	add_drag_cases<float>(cases, sweep);
+	add_drag_cases<double>(cases, sweep);
+	add_project_cases<float>(cases, sweep);
+	add_project_cases<double>(cases, sweep);
+	add_surface_cases<float>(cases, sweep);
+	add_surface_cases<double>(cases, sweep);
+	add_derivs_cases<float>(cases, sweep);
+	add_derivs_cases<double>(cases, sweep);
+	add_adaptive_cases(cases);
+	add_extract_cases<float>(cases, sweep);
+	add_extract_cases<double>(cases, sweep);
+
+	PerfCounter perf;
+	if (!csv && !perf.IsValid()) {
+		printf("# perf_event cache-miss counter not available\n");
+	}
+
+	if (csv) {
+		printf("kernel,precision,order,npts,points,ns_per_point,points_per_sec,allocs_per_call,misses_per_call,error,tolerance,ok\n");
+	} else {
+		printf("%-36s %-6s %5s %5s %7s %10s %9s %8s %10s %10s %s\n", "kernel", "prec", "order", "npts",
+			"points", "ns/point", "Mpts/s", "allocs", "misses", "error", "ok");
+	}
+
+	int failed = 0;
+	for (auto& c : cases)
+	{
+		const std::string name = c.kernel + " " + c.precision;
+		if (!filter.empty() && name.find(filter) == std::string::npos) {
+			continue;
+		}
+
+		double err = -1;
+		bool ok = true;
+		if (check)
+		{
+			c.run();
+			err = c.error();
+			ok = err <= c.tol;
+			if (!ok) {
+				++failed;
+			}
+		}
+
+		const Result r = measure(c, min_time, perf);
+
+		char misses[32] = "-";
+		if (r.misses >= 0) {
+			snprintf(misses, sizeof(misses), "%.1f", r.misses);
+		}
+		char error[32] = "-";
+		if (check) {
+			snprintf(error, sizeof(error), "%.2e", err);
+		}
+
+		if (csv) {
+			printf("%s,%s,%d,%d,%d,%.3f,%.0f,%.2f,%s,%s,%.2e,%s\n", c.kernel.c_str(), c.precision, c.order,
+				c.npts, c.points, r.ns_per_point, 1e9 / r.ns_per_point, r.allocs, misses, error, c.tol,
+				check ? (ok ? "yes" : "NO") : "-");
+		} else {
+			printf("%-36s %-6s %5d %5d %7d %10.3f %9.2f %8.2f %10s %10s %s\n", c.kernel.c_str(), c.precision,
+				c.order, c.npts, c.points, r.ns_per_point, 1e3 / r.ns_per_point, r.allocs, misses, error,
+				check ? (ok ? "yes" : "NO") : "-");
+		}
+		fflush(stdout);
+	}
+
+	if (failed > 0) {
+		fprintf(stderr, "%d case(s) outside tolerance\n", failed);
+		return 1;
+	}
+	return 0;
+}
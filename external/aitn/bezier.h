@@ -6,6 +6,8 @@
 
 #include "bezier_util.h"
 
+#include <vector>
+
 namespace aitn
 {
 
@@ -14,10 +16,8 @@ namespace aitn
                   b[1] contains the x-component of the vertex
                   b[2] contains the y-component of the vertex
                   b[3] contains the z-component of the vertex
-    Basis      = function to calculate the Bernstein basis value (see MECG Eq 5-65)
+    bezier_point = Horner evaluation of the Bernstein form (see MECG Eq 5-65)
     cpts       = number of points to be calculated on the curve
-    Fractrl    = function to calculate the factorial of a number
-    j[]        = array containing the basis functions for a single value of t
     npts       = number of defining polygon vertices
     p[]        = array containing the curve points
                  p[1] contains the x-component of the point
@@ -28,11 +28,8 @@ namespace aitn
 template <typename T, int N>
 void bezier(int npts, const T b[], int cpts, T p[])
 {
-    int i;
-    int j;
     int i1;
     int icount;
-    int jcount;
 
     T step;
     T t;
@@ -47,26 +44,121 @@ void bezier(int npts, const T b[], int cpts, T p[])
 
         if ((1.0 - t) < 5e-6) t = 1.0;
 
-        for (j = 0; j < N; j++){ /* generate a point on the curve */
-            jcount = j;
-            p[icount+j] = 0.;
-            for (i = 0; i < npts; i++){ /* Do x,y,z components */
-                p[icount + j] = p[icount + j] + Basis(npts-1,i,t)*b[jcount];
-                jcount = jcount + N;
-            }
-        }
+        bezier_point<T, N>(npts, b, t, &p[icount]); /* generate a point on the curve */
 
         icount = icount + N;
         t = t + step;
     } 
 }
 
+/* Bezier curve subroutine using forward differencing */
+/*  a[]        = power basis coefficients of the curve
+    b[]        = array containing the defining polygon vertices
+    cpts       = number of points to be calculated on the curve
+    d[]        = forward differences at the current point, d[m] = m-th
+    h          = parameter step
+    npts       = number of defining polygon vertices
+    p[]        = array containing the curve points
+    s[]        = Stirling numbers of the second kind S(k, m) for one m
+    work[]     = workspace of npts*(2*N+1) values
+
+    After the start-up each point costs (npts-1)*N additions. The start
+    differences are taken from the power basis, D^m t^k = m! S(k,m) h^k,
+    not from sampled points, which keeps the error growth small for the
+    low degrees used in practice. Past degree 7 the power basis cancels
+    badly and the differences drift by orders of magnitude in float, so
+    nets of more than 8 vertices, like those with no more vertices than
+    points, are handed to bezier(). The last point is set to the end
+    vertex.
+*/
+template <typename T, int N>
+void bezier_fd(int npts, const T b[], int cpts, T p[], T work[])
+{
+    int i;
+    int k;
+    int m;
+    int c;
+    int n;
+    int i1;
+
+    T h;
+    T hk;
+    T mfact;
+    T sign;
+    T prev;
+    T next;
+    T* a;
+    T* d;
+    T* s;
+
+    n = npts - 1;
+    if (cpts <= npts || npts > 8){
+        bezier<T, N>(npts, b, cpts, p);
+        return;
+    }
+
+    a = work;
+    d = work + npts*N;
+    s = work + 2*npts*N;
+
+    /* power basis a[k] = C(n,k) sum (-1)^(k-i) C(k,i) b[i] */
+    for (k = 0; k <= n; k++){
+        for (c = 0; c < N; c++) a[k*N + c] = 0.;
+        sign = 1;
+        for (i = k; i >= 0; i--){
+            for (c = 0; c < N; c++) a[k*N + c] = a[k*N + c] + sign*binomial<T>(k, i)*b[i*N + c];
+            sign = -sign;
+        }
+        for (c = 0; c < N; c++) a[k*N + c] = a[k*N + c]*binomial<T>(n, k);
+    }
+
+    /* d[m] = m! sum S(k,m) a[k] h^k, starting from S(k,0) */
+    h = static_cast<T>(1.0)/((T)(cpts -1));
+    for (k = 0; k <= n; k++) s[k] = k == 0 ? 1 : 0;
+    for (c = 0; c < N; c++) d[c] = a[c];
+    mfact = 1;
+    for (m = 1; m <= n; m++){
+        prev = s[m - 1];
+        s[m - 1] = 0;
+        for (k = m; k <= n; k++){
+            next = s[k];
+            s[k] = m*s[k - 1] + prev;
+            prev = next;
+        }
+        mfact = mfact*m;
+        for (c = 0; c < N; c++) d[m*N + c] = 0.;
+        hk = 1;
+        for (k = 0; k < m; k++) hk = hk*h;
+        for (k = m; k <= n; k++){
+            for (c = 0; c < N; c++) d[m*N + c] = d[m*N + c] + s[k]*a[k*N + c]*hk;
+            hk = hk*h;
+        }
+        for (c = 0; c < N; c++) d[m*N + c] = d[m*N + c]*mfact;
+    }
+
+    for (c = 0; c < N; c++) p[c] = d[c];
+    for (i1 = 1; i1 < cpts; i1++){
+        for (m = 0; m < n; m++){
+            for (c = 0; c < N; c++) d[m*N + c] = d[m*N + c] + d[(m + 1)*N + c];
+        }
+        for (c = 0; c < N; c++) p[i1*N + c] = d[c];
+    }
+
+    for (c = 0; c < N; c++) p[(cpts - 1)*N + c] = b[n*N + c];
+}
+
+template <typename T, int N>
+void bezier_fd(int npts, const T b[], int cpts, T p[])
+{
+    std::vector<T> work(npts * (2 * N + 1));
+    bezier_fd<T, N>(npts, b, cpts, p, work.data());
+}
+
 /* Bezier curve subroutine */
 /*  b[]        = array containing the defining polygon vertices
                   b[1] contains the x-component of the vertex
                   b[2] contains the y-component of the vertex
                   b[3] contains the z-component of the vertex
-    Basis      = function to calculate the Bernstein basis value (see MECG Eq 5-65)
     cpts       = number of points to be calculated on the curve
     d1[]       = array containing the first derivative of the curve
                  d1[1] contains the x-component of the first derivative
@@ -76,29 +168,28 @@ void bezier(int npts, const T b[], int cpts, T p[])
                  d2[1] contains the x-component of the second derivative
                  d2[2] contains the y-component of the second derivative
                  d2[3] contains the z-component of the second derivative
-    Fractrl    = function to calculate the factorial of a number
-    j[]        = array containing the basis functions for a single value of t
     npts       = number of defining polygon vertices
     p[]        = array containing the curve points
                  p[1] contains the x-component of the point
                  p[2] contains the y-component of the point
                  p[3] contains the z-component of the point
     t          = parameter value 0 <= t <= 1
+
+    The derivatives are the Bezier curves of the differenced polygon
+    (hodographs), so t = 0 and t = 1 need no special treatment.
 */
 template <typename T, int N>
-void dbezier(int npts, T b[], int cpts, T p[], T d1[], T d2[])
+void dbezier(int npts, const T b[], int cpts, T p[], T d1[], T d2[])
 {
-    int i;
-    int j;
+    int c;
+    int n;
     int i1;
     int icount;
-    int jcount;
 
     T step;
     T t;
-    T tempbasis;
-    T temp1;
-    T temp2;
+
+    n = npts - 1;
 
     /* calculate the points on the Bezier curve */
 
@@ -106,42 +197,33 @@ void dbezier(int npts, T b[], int cpts, T p[], T d1[], T d2[])
     t = 0;
     step = static_cast<T>(1.0)/((T)(cpts -1));
 
-    for (i1 = 1; i1<=cpts; i1++){ /* main loop */
+    for (i1 = 0; i1 < cpts; i1++){ /* main loop */
 
         if ((1.0 - t) < 5e-6) t = 1.0;
 
-        for (j = 1; j <= N; j++){ /* generate a point on the curve */
-            jcount = j;
-            p[icount+j] = 0.;
-            d1[icount+j] = 0.;
-            d2[icount+j] = 0.;
-
-			if (t == 0.){ /* derivatives at t=0, jcount = 1,2,3 for x,y,z */
-                d1[icount + j] = (npts-1)*(b[jcount+N]- b[jcount]);
-                d2[icount + j] = (npts-1)*(npts-2)*(b[jcount] - 2*b[jcount+N] + b[jcount+6]);
-			}
-			
-            for (i = 1; i <= npts; i++){ /* Do x,y,z components */
-                tempbasis = Basis(npts-1,i-1,t);
-                p[icount + j] = p[icount + j] + tempbasis*b[jcount];
-                if (t != 0. && t != 1.){
-                    d1[icount + j] = d1[icount + j] + (((i-1)-(npts-1)*t)/(t*(1-t)))*tempbasis*b[jcount];
-                    temp1 = ((i-1)-(npts-1)*t)*((i-1)-(npts-1)*t);
-                    temp2 = temp1-(npts-1)*t*t - (i-1)*(1-2*t);
-                    d2[icount + j] = d2[icount + j] + ((temp2)/(t*t*(1-t)*(1-t)))*tempbasis*b[jcount];
-                }
-
-   			    if (t == 1.){ /* derivatives at t=1, jcount = cpts-2,1,0 for x,y,z */
-                    d1[icount + j] = (npts-1)*(b[jcount] - b[jcount-N]);
-                    d2[icount + j] = (npts-1)*(npts-2)*(b[jcount] - 2*b[jcount-N] + b[jcount-6]);
-                }
-                jcount = jcount + N;
-            }
+        bezier_point<T, N>(npts, b, t, &p[icount]);
+
+        if (n >= 1){
+            horner<T, N>(n - 1, t, [b](int i, int c) {
+                return b[(i + 1)*N + c] - b[i*N + c];
+            }, &d1[icount]);
+            for (c = 0; c < N; c++) d1[icount + c] = d1[icount + c]*n;
+        } else {
+            for (c = 0; c < N; c++) d1[icount + c] = 0.;
+        }
+
+        if (n >= 2){
+            horner<T, N>(n - 2, t, [b](int i, int c) {
+                return b[(i + 2)*N + c] - 2*b[(i + 1)*N + c] + b[i*N + c];
+            }, &d2[icount]);
+            for (c = 0; c < N; c++) d2[icount + c] = d2[icount + c]*n*(n - 1);
+        } else {
+            for (c = 0; c < N; c++) d2[icount + c] = 0.;
         }
 
         icount = icount + N;
         t = t + step;
-    } 
+    }
 }
 
 }
\ No newline at end of file
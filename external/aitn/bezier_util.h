@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <cmath>
+
 namespace aitn
 {
 
@@ -12,28 +14,48 @@ namespace aitn
 template <typename T>
 T factrl(int n)
 {
-    static int ntop=6;
-    static T a[33]={1.0,1.0,2.0,6.0,24.0,120.0,720.0}; /* fill in the first few values */
-    int j1;
+    T a = 1;
+    for (int j = 2; j <= n; j++) {
+        a = a * j;
+    }
+    return a; /* returns the value n! as a floating point number */
+}
 
-    if (n < 0) printf("\nNegative factorial in routine FACTRL\n");
-    if (n > 32) printf("\nFactorial value too large in routine FACTRL\n");
+/* function to calculate the binomial coefficient n!/(i!(n-i)!) without
+   forming the factorials, exact in double for n <= 56 */
 
-    while (ntop < n) { /* use the precalulated value for n = 0....6 */
-        j1 = ntop++;
-        a[n]=a[j1]*ntop;
+template <typename T>
+constexpr T binomial(int n, int i)
+{
+    T r = 1;
+    if (i < 0 || i > n) return 0;
+    if (i > n - i) i = n - i;
+    for (int j = 1; j <= i; j++) {
+        r = r * (n - i + j) / j;
     }
-    return a[n]; /* returns the value n! as a floating point number */
+    return r;
 }
 
+/* binomial coefficients of a known degree, built at compile time */
+
+template <typename T, int n>
+struct binomial_table
+{
+    T c[n + 1];
+
+    constexpr binomial_table() : c() {
+        for (int i = 0; i <= n; i++) {
+            c[i] = binomial<T>(n, i);
+        }
+    }
+};
+
 /* function to calculate the factorial function for Bernstein basis */
 
 template <typename T>
 T Ni(int n,int i)
 {
-    T ni;
-    ni = factrl<T>(n)/(factrl<T>(i)*factrl<T>(n-i));
-    return ni;
+    return binomial<T>(n, i);
 }
 
 /* function to calculate the Bernstein basis */
@@ -53,4 +75,98 @@ T Basis(int n,int i,T t)
     return basis;
 }
 
-}
\ No newline at end of file
+/* function to calculate all n+1 Bernstein basis functions of degree n for
+   one value of t, without pow or factorials
+
+    j[]        = array receiving J[n,0](t) ... J[n,n](t)
+*/
+
+template <typename T>
+void bernstein(int n, T t, T j[])
+{
+    int i;
+    T s, ti, nci;
+
+    s = 1 - t;
+
+    /* j[i] = C(n,i) * t^i, then multiply in (1-t)^(n-i) from the top down */
+    ti = 1;
+    nci = 1;
+    for (i = 0; i <= n; i++){
+        j[i] = nci*ti;
+        ti = ti*t;
+        nci = nci*(n - i)/(i + 1);
+    }
+
+    ti = 1;
+    for (i = n; i >= 0; i--){
+        j[i] = j[i]*ti;
+        ti = ti*s;
+    }
+}
+
+/* Horner evaluation of a Bezier polynomial of degree n for N components
+
+    ctl(i, c)  = component c of the i-th control value
+    p[]        = array receiving the N components of the point
+*/
+
+template <typename T, int N, typename F>
+void horner(int n, T t, F ctl, T p[])
+{
+    int i, c;
+    T s, ti, nci;
+
+    if (n == 0){
+        for (c = 0; c < N; c++) p[c] = ctl(0, c);
+        return;
+    }
+
+    s = 1 - t;
+    ti = 1;
+    nci = 1;
+    for (c = 0; c < N; c++) p[c] = ctl(0, c)*s;
+    for (i = 1; i < n; i++){
+        ti = ti*t;
+        nci = nci*(n - i + 1)/i;
+        for (c = 0; c < N; c++) p[c] = (p[c] + ti*nci*ctl(i, c))*s;
+    }
+    ti = ti*t;
+    for (c = 0; c < N; c++) p[c] = p[c] + ti*ctl(n, c);
+}
+
+/* point on a Bezier curve at one value of t
+
+    b[]        = npts defining polygon vertices of N components each
+    p[]        = array receiving the N components of the point
+*/
+
+template <typename T, int N>
+void bezier_point(int npts, const T b[], T t, T p[])
+{
+    horner<T, N>(npts - 1, t, [b](int i, int c) { return b[i*N + c]; }, p);
+}
+
+/* point on a Bezier curve of compile time degree, the binomial
+   coefficients are constants and the loops unroll */
+
+template <typename T, int N, int Degree>
+void bezier_point(const T b[], T t, T p[])
+{
+    static constexpr binomial_table<T, Degree> nc;
+
+    int i, c;
+    T s, ti;
+
+    s = 1 - t;
+    ti = 1;
+    for (c = 0; c < N; c++) p[c] = b[c]*s;
+    for (i = 1; i < Degree; i++){
+        ti = ti*t;
+        for (c = 0; c < N; c++) p[c] = (p[c] + ti*nc.c[i]*b[i*N + c])*s;
+    }
+    ti = ti*t;
+    for (c = 0; c < N; c++) p[c] = Degree == 0 ? b[c] : p[c] + ti*b[Degree*N + c];
+}
+
+}
@@ -6,31 +6,42 @@
 
 #include "bezier_util.h"
 
+#include <vector>
+
 namespace aitn
 {
 
 /* Bezier surface subroutine */
+/*  b[]        = (n+1) x (m+1) polygon net, 3 components each, w varying fastest
+    jin[]      = Bernstein basis functions in the u direction (see Eq.(5.2))
+    kjm[]      = Bernstein basis functions in the w direction
+    n, m       = degree in the u and w direction
+    p1, p2     = number of parametric lines in the u and w direction
+    q[]        = array receiving the p1 x p2 surface points
+    work[]     = workspace of (n+1) + (m+1) values
+*/
 template <typename T>
-void bezsurf(T b[], int n, int m, int p1, int p2, T q[])
+void bezsurf(const T b[], int n, int m, int p1, int p2, T q[], T work[])
 {
     int i;
     int j;
-    int k;
-    int i1;
     int j1;
     int jbas;
     int uinc;
     int winc;
     int icount;
-    int ch;
 
     T u;
     T w;
-    T jin;
-    T kjm;
+    T* jin;
+    T* kjm;
+    T pbasis;
     T stepu;
     T stepw;
-    
+
+    jin = work;
+    kjm = work + n + 1;
+
     icount = 0;
     stepu = 1.0/((T)(p1-1));
     stepw = 1.0/((T)(p2-1));
@@ -39,21 +50,23 @@ void bezsurf(T b[], int n, int m, int p1, int p2, T q[])
     
     for (uinc = 0; uinc < p1; uinc++){  /* for fixed u calculate various w's */
         if (1.0 - u < 5e-6) u=1.0; /* fix up the u = 1 value because of float */
+        bernstein(n,u,jin); /* Bernstein basis functions in the u direction */
         w = 0.0;
         for (winc = 0; winc < p2; winc++){
             if (1.0 - w < 5e-6) w=1.0; /* fix up the w = 1 value because of float */
+            bernstein(m,w,kjm); /* Bernstein basis functions in the w direction */
+            q[icount] = 0.;
+            q[icount+1] = 0.;
+            q[icount+2] = 0.;
             for (i = 0; i <= n; i++){
-                jin = Basis(n,i,u); /* Bernstein basis function in the u direction (see Eq.(5.2)) */
-                if (jin != 0.){ /* don't bother no contribution */
+                if (jin[i] != 0.){ /* don't bother no contribution */
                     jbas = 3 * (m + 1) * i; /* column index for lineal array*/
                     for (j = 0; j <= m; j++){
-                        kjm = Basis(m,j,w);  /* Bernstein basis function in the w direction (see Eq.(5.2)) */
-                        if (kjm !=0.){ /* don't bother no contribution */
-                            j1 = jbas + 3 * j;
-                            q[icount] = q[icount]+b[j1]*jin*kjm; /* calculate the surface points */
-                            q[icount+1] = q[icount+1]+b[j1+1]*jin*kjm;
-                            q[icount+2] = q[icount+2]+b[j1+2]*jin*kjm;
-                        }
+                        pbasis = jin[i]*kjm[j];
+                        j1 = jbas + 3 * j;
+                        q[icount] = q[icount]+b[j1]*pbasis; /* calculate the surface points */
+                        q[icount+1] = q[icount+1]+b[j1+1]*pbasis;
+                        q[icount+2] = q[icount+2]+b[j1+2]*pbasis;
                     }
                 }
             }
@@ -64,4 +77,11 @@ void bezsurf(T b[], int n, int m, int p1, int p2, T q[])
     }
 }
 
+template <typename T>
+void bezsurf(const T b[], int n, int m, int p1, int p2, T q[])
+{
+    std::vector<T> work(n + m + 2);
+    bezsurf(b, n, m, p1, p2, q, work.data());
+}
+
 }
\ No newline at end of file
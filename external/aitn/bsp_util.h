@@ -7,6 +7,48 @@
 namespace aitn
 {
 
+/*  Workspace sizes for the B-spline kernels.
+
+    The kernels take their scratch memory from the caller so that they
+    allocate nothing and are safe for any number of control points. The
+    original signatures, without x[] and work[], remain next to them as
+    compatibility versions which allocate on every call.
+
+    bsp_knot_size = number of ints needed for the knot vector x[]
+    bsp_work_size = number of T values needed by a curve kernel
+                    (the c nonzero basis functions and the left/right
+                    differences of basis_span)
+    bspsurf_work_size = number of T values needed by a surface kernel
+                    (u and w basis functions followed by left/right)
+    dbasis_work_size = number of T values needed by dbasis_span
+                    (the c x c triangle ndu, two rows of coefficients a
+                    and the left/right differences)
+
+    Only the c nonzero basis functions are evaluated, so the work sizes
+    depend on the orders alone. npts and mpts are unused; they are kept
+    so that callers written for the dense basis still compile.
+*/
+
+inline int bsp_knot_size(int npts, int c)
+{
+	return npts + c;
+}
+
+inline int bsp_work_size(int /*npts*/, int c)
+{
+	return 3 * c;
+}
+
+inline int bspsurf_work_size(int /*npts*/, int /*mpts*/, int k, int l)
+{
+	return k + l + 2 * (k > l ? k : l);
+}
+
+inline int dbasis_work_size(int c)
+{
+	return c * c + 4 * c;
+}
+
 /*
     Subroutine to generate a B-spline open knot vector with multiplicity
     equal to the order at the ends.
@@ -18,7 +60,7 @@ namespace aitn
     x()          = array containing the knot vector
 */
 
-void knot(int n, int c,  int x[])
+inline void knot(int n, int c,  int x[])
 {
 	int nplusc, nplus2, i;
 
@@ -43,7 +85,7 @@ void knot(int n, int c,  int x[])
     x[]          = array containing the knot vector
 */
 
-void knotu(int n, int c, int x[])
+inline void knotu(int n, int c, int x[])
 {
     int nplusc, i;
 
@@ -70,30 +112,22 @@ void knotu(int n, int c, int x[])
                n[1] contains the basis function associated with B1 etc.
     nplusc   = constant -- npts + c -- maximum number of knot values
     t        = parameter value
-    temp[]   = temporary array
+    temp[]   = temporary array, at least npts + c values
     x[]      = knot vector
 */	
 
 template <typename T>
-void basis(int c, T t, int npts, int x[], T n[])
+void basis(int c, T t, int npts, const int x[], T n[], T temp[])
 {
 	int nplusc;
 	int i,k;
 	T d,e;
-	T temp[36];
 
 	nplusc = npts + c;
 
-/*		printf("knot vector is \n");
-		for (i = 1; i <= nplusc; i++){
-			printf(" %d %d \n", i,x[i]);
-		}
-		printf("t is %f \n", t);
-*/
-
 /* calculate the first order basis functions n[i][1]	*/
 
-	for (i = 0; i < nplusc; i++){
+	for (i = 0; i < nplusc - 1; i++){
     	if (( t >= x[i]) && (t < x[i+1]))
 			temp[i] = 1;
 	    else
@@ -129,4 +163,162 @@ void basis(int c, T t, int npts, int x[], T n[])
 	}
 }
 
-}
\ No newline at end of file
+
+/*  Subroutine to find the knot span containing a parameter value
+    (binary search, see The NURBS Book Alg. A2.1).
+
+    c        = order of the B-spline basis function
+    npts     = number of defining polygon vertices
+    t        = parameter value x[c-1] <= t <= x[npts]
+    x[]      = knot vector, any type that can be indexed
+
+    Returns the index i, c-1 <= i <= npts-1, with x[i] <= t < x[i+1]. The
+    last parameter value is put into the last non-empty span.
+*/
+
+template <typename T, typename K>
+int find_span(int c, T t, int npts, const K& x)
+{
+	int low, high, mid;
+
+	if (t >= x[npts]) {
+		return npts - 1;
+	}
+	if (t <= x[c - 1]) {
+		return c - 1;
+	}
+
+	low = c - 1;
+	high = npts;
+	mid = (low + high) / 2;
+	while (t < x[mid] || t >= x[mid + 1]) {
+		if (t < x[mid])
+			high = mid;
+		else
+			low = mid;
+		mid = (low + high) / 2;
+	}
+	return mid;
+}
+
+/*  Subroutine to generate only the nonzero B-spline basis functions
+    (Cox-de Boor recursion, see The NURBS Book Alg. A2.2).
+
+    c        = order of the B-spline basis function
+    left[]   = temporary array, c values
+    n[]      = array receiving the c nonzero basis functions,
+               n[0] is the basis function associated with B[span-c+1]
+    right[]  = temporary array, c values
+    span     = knot span from find_span()
+    t        = parameter value
+    x[]      = knot vector, any type that can be indexed
+*/
+
+template <typename T, typename K>
+void basis_span(int c, T t, int span, const K& x, T n[], T left[], T right[])
+{
+	int j, r;
+	T saved, temp;
+
+	n[0] = 1;
+	for (j = 1; j < c; j++) {
+		left[j] = t - x[span + 1 - j];
+		right[j] = x[span + j] - t;
+		saved = 0;
+		for (r = 0; r < j; r++) {
+			temp = n[r] / (right[r + 1] + left[j - r]);
+			n[r] = saved + right[r + 1] * temp;
+			saved = left[j - r] * temp;
+		}
+		n[j] = saved;
+	}
+}
+
+/*  Subroutine to generate the nonzero B-spline basis functions and their
+    derivatives (see The NURBS Book Alg. A2.3).
+
+    c        = order of the B-spline basis function
+    ders[]   = array receiving (nd + 1) rows of c values, row d holds the
+               d-th derivatives; rows above c - 1 are zero
+    nd       = number of derivatives
+    span     = knot span from find_span()
+    t        = parameter value
+    work[]   = workspace of dbasis_work_size(c) values
+    x[]      = knot vector, any type that can be indexed
+*/
+
+template <typename T, typename K>
+void dbasis_span(int c, T t, int span, const K& x, int nd, T ders[], T work[])
+{
+	int i, j, k, r, s1, s2, j1, j2, rk, pk;
+	int p = c - 1;
+	T saved, temp, d;
+	T* ndu = work;                /* basis values above the diagonal, knot differences below */
+	T* a = work + c * c;          /* two rows of c */
+	T* left = a + 2 * c;
+	T* right = left + c;
+
+	ndu[0] = 1;
+	for (j = 1; j <= p; j++) {
+		left[j] = t - x[span + 1 - j];
+		right[j] = x[span + j] - t;
+		saved = 0;
+		for (r = 0; r < j; r++) {
+			ndu[j * c + r] = right[r + 1] + left[j - r];
+			temp = ndu[r * c + j - 1] / ndu[j * c + r];
+			ndu[r * c + j] = saved + right[r + 1] * temp;
+			saved = left[j - r] * temp;
+		}
+		ndu[j * c + j] = saved;
+	}
+
+	for (j = 0; j <= p; j++) {
+		ders[j] = ndu[j * c + p];
+	}
+	for (k = 1; k <= nd; k++) {
+		for (j = 0; j <= p; j++) {
+			ders[k * c + j] = 0;
+		}
+	}
+
+/*  differentiate the basis functions of the span */
+
+	for (r = 0; r <= p; r++) {
+		s1 = 0;
+		s2 = 1;
+		a[0] = 1;
+		for (k = 1; k <= nd && k <= p; k++) {
+			d = 0;
+			rk = r - k;
+			pk = p - k;
+			if (r >= k) {
+				a[s2 * c] = a[s1 * c] / ndu[(pk + 1) * c + rk];
+				d = a[s2 * c] * ndu[rk * c + pk];
+			}
+			j1 = rk >= -1 ? 1 : -rk;
+			j2 = r - 1 <= pk ? k - 1 : p - r;
+			for (j = j1; j <= j2; j++) {
+				a[s2 * c + j] = (a[s1 * c + j] - a[s1 * c + j - 1]) / ndu[(pk + 1) * c + rk + j];
+				d = d + a[s2 * c + j] * ndu[(rk + j) * c + pk];
+			}
+			if (r <= pk) {
+				a[s2 * c + k] = -a[s1 * c + k - 1] / ndu[(pk + 1) * c + r];
+				d = d + a[s2 * c + k] * ndu[r * c + pk];
+			}
+			ders[k * c + r] = d;
+			i = s1;
+			s1 = s2;
+			s2 = i;
+		}
+	}
+
+	r = p;
+	for (k = 1; k <= nd && k <= p; k++) {
+		for (j = 0; j <= p; j++) {
+			ders[k * c + j] = ders[k * c + j] * r;
+		}
+		r = r * (p - k);
+	}
+}
+
+}
@@ -6,6 +6,8 @@
 
 #include "bsp_util.h"
 
+#include <vector>
+
 namespace aitn
 {
 
@@ -21,7 +23,7 @@ namespace aitn
                   b[2] contains the y-component of the vertex
                   b[3] contains the z-component of the vertex
     k           = order of the \bsp basis function
-    nbasis      = array containing the basis functions for a single value of t
+    nbasis      = array containing the k nonzero basis functions for a single value of t
     nplusc      = number of knot values
     npts        = number of defining polygon vertices
     p[,]        = array containing the curve points
@@ -30,29 +32,28 @@ namespace aitn
                   p[3] contains the z-component of the point
     p1          = number of points to be calculated on the curve
     t           = parameter value 0 <= t <= 1
-    x[]         = array containing the knot vector
+    work[]      = workspace of bsp_work_size(npts, k) values
+    x[]         = array containing the knot vector, bsp_knot_size(npts, k) values
 */
 
 template <typename T>
-void bspline(int npts, int k, int p1, T b[], T p[])
+void bspline(int npts, int k, int p1, const T b[], T p[], int x[], T work[])
 {
 	int i,j,icount,jcount;
 	int i1;
-	int x[30];		/* allows for 20 data points with basis function of order 5 */
 	int nplusc;
 
 	T step;
 	T t;
-	T nbasis[20];
+	int span;
+	T* nbasis = work;		/* k nonzero basis values, then the left/right differences */
+	T* left = work + k;
+	T* right = work + 2 * k;
 	T temp;
 
 	nplusc = npts + k;
 
-/*  zero and redimension the knot vector and the basis array */
-
-	for(i = 0; i < npts; i++){
-		 nbasis[i] = 0.;
-	}
+/*  zero and redimension the knot vector */
 
 	for(i = 0; i < nplusc; i++){
 		 x[i] = 0.;
@@ -83,7 +84,8 @@ void bspline(int npts, int k, int p1, T b[], T p[])
 			t = (T)x[nplusc - 1];
 		}
 
-	    basis(k,t,npts,x,nbasis);      /* generate the basis function for this value of t */
+		span = find_span(k,t,npts,x);
+	    basis_span(k,t,span,x,nbasis,left,right);      /* generate the k nonzero basis functions for this value of t */
 /*
 		printf("t = %f \n",t);
 		printf("nbasis = ");
@@ -93,10 +95,10 @@ void bspline(int npts, int k, int p1, T b[], T p[])
 		printf("\n");
 */
 		for (j = 0; j < 3; j++){      /* generate a point on the curve */
-			jcount = j;
+			jcount = 3*(span-k+1) + j;
 			p[icount+j] = 0.;
 
-			for (i = 0; i < npts; i++){ /* Do local matrix multiplication */
+			for (i = 0; i < k; i++){ /* Do local matrix multiplication */
 				temp = nbasis[i]*b[jcount];
 			    p[icount + j] = p[icount + j] + temp;
 /*
@@ -113,6 +115,17 @@ void bspline(int npts, int k, int p1, T b[], T p[])
 	}
 }
 
+/*  Compatibility version of bspline() which allocates x[] and work[] on
+    every call. */
+
+template <typename T>
+void bspline(int npts, int k, int p1, const T b[], T p[])
+{
+	std::vector<int> x(bsp_knot_size(npts, k));
+	std::vector<T> work(bsp_work_size(npts, k));
+	bspline(npts, k, p1, b, p, x.data(), work.data());
+}
+
 /*  Name: bsplineu.c
 	Language: C
 	Subroutines called: knotu.c, basis.c, fmtmul.c
@@ -123,7 +136,7 @@ void bspline(int npts, int k, int p1, T b[], T p[])
                   b[2] contains the y-component of the vertex
                   b[3] contains the z-component of the vertex
     k           = order of the B-spline basis function
-    nbasis      = array containing the basis functions for a single value of t
+    nbasis      = array containing the k nonzero basis functions for a single value of t
     nplusc      = number of knot values
     npts        = number of defining polygon vertices
     p[,]        = array containing the curve points
@@ -132,29 +145,28 @@ void bspline(int npts, int k, int p1, T b[], T p[])
                   p[3] contains the z-component of the point
     p1          = number of points to be calculated on the curve
     t           = parameter value 0 <= t <= 1
-    x[]         = array containing the knot vector
+    work[]      = workspace of bsp_work_size(npts, k) values
+    x[]         = array containing the knot vector, bsp_knot_size(npts, k) values
 */
 
 template <typename T>
-void bsplineu(int npts, int k, int p1, T b[], T p[])
+void bsplineu(int npts, int k, int p1, const T b[], T p[], int x[], T work[])
 {
 	int i,j,icount,jcount;
 	int i1;
-	int x[30];		/* allows for 20 data points with basis function of order 5 */
 	int nplusc;
 
 	T step;
 	T t;
-	T nbasis[20];
+	int span;
+	T* nbasis = work;		/* k nonzero basis values, then the left/right differences */
+	T* left = work + k;
+	T* right = work + 2 * k;
 	T temp;
 
 	nplusc = npts + k;
 
-/*  zero and redimension the knot vector and the basis array */
-
-	for(i = 0; i < npts; i++){
-		 nbasis[i] = 0.;
-	}
+/*  zero and redimension the knot vector */
 
 	for(i = 0; i < nplusc; i++){
 		 x[i] = 0.;
@@ -185,7 +197,8 @@ void bsplineu(int npts, int k, int p1, T b[], T p[])
 			t = (T)((npts));
 		}
 
-	    basis(k,t,npts,x,nbasis);      /* generate the basis function for this value of t */
+		span = find_span(k,t,npts,x);
+	    basis_span(k,t,span,x,nbasis,left,right);      /* generate the k nonzero basis functions for this value of t */
 /*
 		printf("t = %f \n",t);
 		printf("nbasis = ");
@@ -195,10 +208,10 @@ void bsplineu(int npts, int k, int p1, T b[], T p[])
 		printf("\n");
 */
 		for (j = 0; j < 3; j++){      /* generate a point on the curve */
-			jcount = j;
+			jcount = 3*(span-k+1) + j;
 			p[icount+j] = 0.;
 
-			for (i = 0; i < npts; i++){ /* Do local matrix multiplication */
+			for (i = 0; i < k; i++){ /* Do local matrix multiplication */
 				temp = nbasis[i]*b[jcount];
 			    p[icount + j] = p[icount + j] + temp;
 /*
@@ -215,4 +228,15 @@ void bsplineu(int npts, int k, int p1, T b[], T p[])
 	}
 }
 
+/*  Compatibility version of bsplineu() which allocates x[] and work[] on
+    every call. */
+
+template <typename T>
+void bsplineu(int npts, int k, int p1, const T b[], T p[])
+{
+	std::vector<int> x(bsp_knot_size(npts, k));
+	std::vector<T> work(bsp_work_size(npts, k));
+	bsplineu(npts, k, p1, b, p, x.data(), work.data());
+}
+
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 
 #include "bsp_util.h"
 
+#include <vector>
+
 namespace aitn
 {
 
@@ -21,8 +23,8 @@ namespace aitn
                   b[1] = x-component
                   b[2] = y-component
                   b[3] = z-component
-                  Note: Bi,j = b[] has dimensions of n*m*3 with j varying fastest
-                      The polygon net is n x m
+                  Note: Bi,j = b[] has dimensions of n*m*3 with j varying fastest,
+                      rows are m points apart. The polygon net is n x m
     k           = order in the u direction
     l           = order in the w direction
     mbasis[]    = array containing the nonrational basis functions for one value of w (see \eq{5--84})
@@ -38,22 +40,25 @@ namespace aitn
                        for a fixed value of u the next m elements contain
                        the values for the curve q[u[sub i],w] q has dimensions
                        of p1*p2*3. The display surface is p1 x p2
+    work[]      = workspace of bspsurf_work_size(npts, mpts, k, l) values
+    x[], y[]    = u and w knot vectors, bsp_knot_size() values each
 */
 
 template <typename T>
-void bsplsurf(T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
+void bsplsurf(const T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[],
+    int x[], int y[], T work[])
 {
 
-/*   allows for 20 data points with basis function of order 5 */
-
     int i,j,j1,jbas;
     int icount;
     int uinc,winc;
     int nplusc,mplusc;
-    int x[30],y[30];
-    int temp;
 
-    T nbasis[30],mbasis[30];
+    int uspan,wspan;
+    T* nbasis = work;            /* k nonzero u basis values */
+    T* mbasis = work + k;        /* l nonzero w basis values */
+    T* left = work + k + l;
+    T* right = left + (k > l ? k : l);
     T pbasis;
     T u,w;
     T stepu,stepw;
@@ -75,16 +80,6 @@ void bsplsurf(T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
     for (i = 0; i < mplusc; i++){
         y[i] = 0;
     }
-    for (i = 0; i < npts; i++){
-        nbasis[i] = 0.;
-    }
-    for (i = 0; i < mpts; i++){
-        mbasis[i] = 0.;
-    }
-
-    temp = 3*(p1*p2);
-
-/*  printf("p1*p2*3 = %d \n",temp);*/
 
     for (i = 0; i < 3*p1*p2; i++){
         q[i] = 0.;
@@ -108,7 +103,8 @@ void bsplsurf(T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
         if ((T)x[nplusc - 1] - u < 5e-6){
             u = (T)x[nplusc - 1];
         }
-        basis(k,u,npts,x,nbasis);    /* basis function for this value of u */
+        uspan = find_span(k,u,npts,x);
+        basis_span(k,u,uspan,x,nbasis,left,right);    /* nonzero basis functions for this value of u */
         w = 0.;
         for (winc = 0; winc < p2; winc++)
         {
@@ -116,24 +112,18 @@ void bsplsurf(T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
             if ((T)y[mplusc - 1] - w < 5e-6){
                 w = (T)y[mplusc - 1];
             }
-            basis(l,w,mpts,y,mbasis);    /* basis function for this value of w */
-            for (i = 0; i < npts; i++)
+            wspan = find_span(l,w,mpts,y);
+            basis_span(l,w,wspan,y,mbasis,left,right);    /* nonzero basis functions for this value of w */
+            for (i = 0; i < k; i++)
             {
-                if (nbasis[i] != 0. )
+                jbas = 3 * mpts * (uspan - k + 1 + i) + 3 * (wspan - l + 1);
+                for (j = 0; j < l; j++)
                 {
-                    jbas = 3 * (mpts + 1) * i;
-                    for (j = 0; j < mpts; j++)
-                    {
-                        if (mbasis[j] != 0.)
-                        {
-                            j1 = jbas +3 * j;
-                            pbasis = nbasis[i]*mbasis[j];
-                            q[icount] = q[icount]+b[j1]*pbasis;  /* calculate surface point */
-                            q[icount+1] = q[icount+1]+b[j1+1]*pbasis;
-                            q[icount+2] = q[icount+2]+b[j1+2]*pbasis;
-    /*                      printf("j1,i,j = %d %d %d \n",j1,i,j); */
-                        }
-                    }
+                    j1 = jbas + 3 * j;
+                    pbasis = nbasis[i]*mbasis[j];
+                    q[icount] = q[icount]+b[j1]*pbasis;  /* calculate surface point */
+                    q[icount+1] = q[icount+1]+b[j1+1]*pbasis;
+                    q[icount+2] = q[icount+2]+b[j1+2]*pbasis;
                 }
             }
             icount = icount + 3;
@@ -143,6 +133,17 @@ void bsplsurf(T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
     }
 }
 
+/*  Compatibility version of bsplsurf() which allocates x[] and work[] on
+    every call. */
+
+template <typename T>
+void bsplsurf(const T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
+{
+    std::vector<int> x(bsp_knot_size(npts, k)), y(bsp_knot_size(mpts, l));
+    std::vector<T> work(bspsurf_work_size(npts, mpts, k, l));
+    bsplsurf(b, k, l, npts, mpts, p1, p2, q, x.data(), y.data(), work.data());
+}
+
 /*  Subroutine to calculate a Cartesian product B-spline surface
     using uniform periodic knot vectors (see Eq. 6.1).
 
@@ -155,8 +156,8 @@ void bsplsurf(T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
                   b[1] = x-component
                   b[2] = y-component
                   b[3] = z-component
-                  Note: Bi,j = b[] has dimensions of n*m*3 with j varying fastest
-                      The polygon net is n x m
+                  Note: Bi,j = b[] has dimensions of n*m*3 with j varying fastest,
+                      rows are m points apart. The polygon net is n x m
     k           = order in the u direction
     l           = order in the w direction
     mbasis[]    = array containing the nonrational basis functions for one value of w (see \eq{5--84})
@@ -172,22 +173,25 @@ void bsplsurf(T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
                        for a fixed value of u the next m elements contain
                        the values for the curve q[u[sub i],w] q has dimensions
                        of p1*p2*3. The display surface is p1 x p2
+    work[]      = workspace of bspsurf_work_size(npts, mpts, k, l) values
+    x[], y[]    = u and w knot vectors, bsp_knot_size() values each
 */
 
 template <typename T>
-void bspsurfu(T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
+void bspsurfu(const T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[],
+    int x[], int y[], T work[])
 {
 
-/*   allows for 20 data points with basis function of order 5 */
-
     int i,j,j1,jbas;
     int icount;
     int uinc,winc;
     int nplusc,mplusc;
-    int x[30],y[30];
-    int temp;
 
-    T nbasis[30],mbasis[30];
+    int uspan,wspan;
+    T* nbasis = work;            /* k nonzero u basis values */
+    T* mbasis = work + k;        /* l nonzero w basis values */
+    T* left = work + k + l;
+    T* right = left + (k > l ? k : l);
     T pbasis;
     T u,w;
     T stepu,stepw;
@@ -209,16 +213,6 @@ void bspsurfu(T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
     for (i = 0; i < mplusc; i++){
         y[i] = 0;
     }
-    for (i = 0; i < npts; i++){
-        nbasis[i] = 0.;
-    }
-    for (i = 0; i < mpts; i++){
-        mbasis[i] = 0.;
-    }
-
-    temp = 3*(p1*p2);
-
-/*  printf("p1*p2*3 = %d \n",temp);*/
 
     for (i = 0; i < 3*p1*p2; i++){
         q[i] = 0.;
@@ -242,7 +236,8 @@ void bspsurfu(T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
         if ((T)(npts) - u < 5e-6){
             u = npts;
         }
-        basis(k,u,npts,x,nbasis);    /* basis function for this value of u */
+        uspan = find_span(k,u,npts,x);
+        basis_span(k,u,uspan,x,nbasis,left,right);    /* nonzero basis functions for this value of u */
         w = l-1.;
         for (winc = 0; winc < p2; winc++)
         {
@@ -250,24 +245,18 @@ void bspsurfu(T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
             if ((T)mpts - w < 5e-6){
                 w = mpts;
             }
-            basis(l,w,mpts,y,mbasis);    /* basis function for this value of w */
-            for (i = 0; i < npts; i++)
+            wspan = find_span(l,w,mpts,y);
+            basis_span(l,w,wspan,y,mbasis,left,right);    /* nonzero basis functions for this value of w */
+            for (i = 0; i < k; i++)
             {
-                if (nbasis[i] != 0. )
+                jbas = 3 * mpts * (uspan - k + 1 + i) + 3 * (wspan - l + 1);
+                for (j = 0; j < l; j++)
                 {
-                    jbas = 3 * (mpts + 1) * i;
-                    for (j = 0; j < mpts; j++)
-                    {
-                        if (mbasis[j] != 0.)
-                        {
-                            j1 = jbas + 3 * j;
-                            pbasis = nbasis[i]*mbasis[j];
-                            q[icount] = q[icount]+b[j1]*pbasis;  /* calculate surface point */
-                            q[icount+1] = q[icount+1]+b[j1+1]*pbasis;
-                            q[icount+2] = q[icount+2]+b[j1+2]*pbasis;
-    /*                      printf("j1,i,j = %d %d %d \n",j1,i,j); */
-                        }
-                    }
+                    j1 = jbas + 3 * j;
+                    pbasis = nbasis[i]*mbasis[j];
+                    q[icount] = q[icount]+b[j1]*pbasis;  /* calculate surface point */
+                    q[icount+1] = q[icount+1]+b[j1+1]*pbasis;
+                    q[icount+2] = q[icount+2]+b[j1+2]*pbasis;
                 }
             }
             icount = icount + 3;
@@ -277,4 +266,15 @@ void bspsurfu(T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
     }
 }
 
+/*  Compatibility version of bspsurfu() which allocates x[] and work[] on
+    every call. */
+
+template <typename T>
+void bspsurfu(const T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
+{
+    std::vector<int> x(bsp_knot_size(npts, k)), y(bsp_knot_size(mpts, l));
+    std::vector<T> work(bspsurf_work_size(npts, mpts, k, l));
+    bspsurfu(b, k, l, npts, mpts, p1, p2, q, x.data(), y.data(), work.data());
+}
+
 }
\ No newline at end of file
@@ -1,8 +1,28 @@
 #pragma once
 
+#include "bsp_util.h"
+
 namespace aitn
 {
 
+/*  Name: project_homogeneous
+
+	v[]      = dim coordinates summed in homogeneous form (hx, hy, ...)
+	h        = the summed weight
+	p[]      = v[] / h, zero where h is; may be v itself
+
+	Every rational evaluator sums its points in homogeneous coordinates
+	and ends with this one divide per point.
+*/
+
+template <typename T>
+inline void project_homogeneous(const T v[], T h, int dim, T p[])
+{
+	for (int c = 0; c < dim; c++){
+		p[c] = h != 0 ? v[c]/h : 0;
+	}
+}
+
 /*  Name: rbais
 	Language: C
 	Subroutines called: none
@@ -17,31 +37,23 @@ namespace aitn
     r[]      = array containing the rationalbasis functions
                r[1] contains the basis function associated with B1 etc.
     t        = parameter value
-    temp[]   = temporary array
+    temp[]   = temporary array, at least npts + c values
     x[]      = knot vector
 */	
 
 template <typename T>
-void rbasis(int c, T t, int npts, int x[], T h[], T r[])
+void rbasis(int c, T t, int npts, const int x[], const T h[], T r[], T temp[])
 {
 	int nplusc;
-	int i,j,k;
+	int i,k;
 	T d,e;
 	T sum;
-	T temp[36];
 
 	nplusc = npts + c;
 
-/*		printf("knot vector is \n");
-		for (i = 1; i <= nplusc; i++){
-			printf(" %d %d \n", i,x[i]);
-		}
-		printf("t is %f \n", t);
-*/
-
 /* calculate the first order nonrational basis functions n[i]	*/
 
-	for (i = 0; i< nplusc; i++){
+	for (i = 0; i < nplusc - 1; i++){
     	if (( t >= x[i]) && (t < x[i+1]))
 			temp[i] = 1;
 	    else
@@ -69,13 +81,6 @@ void rbasis(int c, T t, int npts, int x[], T h[], T r[])
 	if (t == (T)x[nplusc - 1]){		/*    pick up last point	*/
  		temp[npts - 1] = 1;
 	}
-/*
-	printf("Nonrational basis functions are \n");
-	for (i=1; i<= npts; i++){
-		printf("%f ", temp[i]);
-	}
-	printf("\n");
-*/
 /* calculate sum for denominator of rational basis functions */
 
 	sum = 0.;
@@ -3,12 +3,14 @@
 #include "bsp_util.h"
 #include "rbsp_util.h"
 
+#include <vector>
+
 namespace aitn
 {
 
 /*  Name: rbspline.c
 	Language: C
-	Subroutines called: knot.c, rbasis.c, fmtmul.c
+	Subroutines called: knot.c, find_span, basis_span
 	Book reference: Chapter 4, Alg. p. 297
 
     b[]         = array containing the defining polygon vertices
@@ -17,7 +19,7 @@ namespace aitn
                   b[3] contains the z-component of the vertex
 	h[]			= array containing the homogeneous weighting factors 
     k           = order of the B-spline basis function
-    nbasis      = array containing the basis functions for a single value of t
+    nbasis      = array containing the k nonzero nonrational basis functions for a single value of t
     nplusc      = number of knot values
     npts        = number of defining polygon vertices
     p[,]        = array containing the curve points
@@ -26,30 +28,30 @@ namespace aitn
                   p[3] contains the z-component of the point
     p1          = number of points to be calculated on the curve
     t           = parameter value 0 <= t <= npts - k + 1
-    x[]         = array containing the knot vector
+    work[]      = workspace of bsp_work_size(npts, k) values
+    x[]         = array containing the knot vector, bsp_knot_size(npts, k) values
 */
 
 template <typename T>
-void rbspline(int npts, int k, int p1, T b[], T h[], T p[])
+void rbspline(int npts, int k, int p1, const T b[], const T h[], T p[], int x[], T work[])
 {
-	int i,j,icount,jcount;
+	int i,icount,jcount;
 	int i1;
-	int x[30];		/* allows for 20 data points with basis function of order 5 */
 	int nplusc;
 
 	T step;
 	T t;
-	T nbasis[20];
+	int span;
+	T* nbasis = work;		/* k nonzero basis values, then the left/right differences */
+	T* left = work + k;
+	T* right = work + 2 * k;
 	T temp;
+	T sum;
 
 
 	nplusc = npts + k;
 
-/*  zero and redimension the knot vector and the basis array */
-
-	for(i = 0; i < npts; i++){
-		 nbasis[i] = 0.;
-	}
+/*  zero and redimension the knot vector */
 
 	for(i = 0; i < nplusc; i++){
 		 x[i] = 0.;
@@ -80,7 +82,8 @@ void rbspline(int npts, int k, int p1, T b[], T h[], T p[])
 			t = (T)x[nplusc - 1];
 		}
 
-	    rbasis(k,t,npts,x,h,nbasis);      /* generate the basis function for this value of t */
+		span = find_span(k,t,npts,x);
+	    basis_span(k,t,span,x,nbasis,left,right);      /* generate the k nonzero basis functions for this value of t */
 /*
 		printf("t = %f \n",t);
 		printf("nbasis = ");
@@ -89,19 +92,18 @@ void rbspline(int npts, int k, int p1, T b[], T h[], T p[])
 		}
 		printf("\n");
 */
-		for (j = 0; j < 3; j++){      /* generate a point on the curve */
-			jcount = j;
-			p[icount+j] = 0.;
-
-			for (i = 0; i < npts; i++){ /* Do local matrix multiplication */
-				temp = nbasis[i]*b[jcount];
-			    p[icount + j] = p[icount + j] + temp;
-/*
-				printf("jcount,nbasis,b,nbasis*b,p = %d %f %f %f %f\n",jcount,nbasis[i],b[jcount],temp,p[icount+j]);
-*/
-				jcount = jcount + 3;
-			}
+		jcount = 3*(span-k+1);
+		sum = 0.;
+		p[icount] = p[icount+1] = p[icount+2] = 0.;
+		for (i = 0; i < k; i++){
+			temp = nbasis[i]*h[span-k+1+i];
+			p[icount] = p[icount] + temp*b[jcount];
+			p[icount+1] = p[icount+1] + temp*b[jcount+1];
+			p[icount+2] = p[icount+2] + temp*b[jcount+2];
+			sum = sum + temp;
+			jcount = jcount + 3;
 		}
+		project_homogeneous(&p[icount],sum,3,&p[icount]);
 /*
 		printf("icount, p %d %f %f %f \n",icount,p[icount+1],p[icount+2],p[icount+3]);
 */
@@ -110,9 +112,20 @@ void rbspline(int npts, int k, int p1, T b[], T h[], T p[])
 	}
 }
 
+/*  Compatibility version of rbspline() which allocates x[] and work[] on
+    every call. */
+
+template <typename T>
+void rbspline(int npts, int k, int p1, const T b[], const T h[], T p[])
+{
+	std::vector<int> x(bsp_knot_size(npts, k));
+	std::vector<T> work(bsp_work_size(npts, k));
+	rbspline(npts, k, p1, b, h, p, x.data(), work.data());
+}
+
 /*  Name: rbsplinu.c
 	Language: C
-	Subroutines called: knotu.c, rbasis.c, fmtmul.c
+	Subroutines called: knotu.c, find_span, basis_span
 	Book reference: Chapter 4, Alg. p. 298
 
     b[]         = array containing the defining polygon vertices
@@ -121,7 +134,7 @@ void rbspline(int npts, int k, int p1, T b[], T h[], T p[])
                   b[3] contains the z-component of the vertex
 	h[]			= array containing the homogeneous weighting factors 
     k           = order of the B-spline basis function
-    nbasis      = array containing the basis functions for a single value of t
+    nbasis      = array containing the k nonzero nonrational basis functions for a single value of t
     nplusc      = number of knot values
     npts        = number of defining polygon vertices
     p[,]        = array containing the curve points
@@ -130,30 +143,30 @@ void rbspline(int npts, int k, int p1, T b[], T h[], T p[])
                   p[3] contains the z-component of the point
     p1          = number of points to be calculated on the curve
     t           = parameter value 0 <= t <= npts - k + 1
-    x[]         = array containing the knot vector
+    work[]      = workspace of bsp_work_size(npts, k) values
+    x[]         = array containing the knot vector, bsp_knot_size(npts, k) values
 */
 
 template <typename T>
-void rbsplineu(int npts, int k, int p1, T b[], T h[], T p[])
+void rbsplineu(int npts, int k, int p1, const T b[], const T h[], T p[], int x[], T work[])
 {
-	int i,j,icount,jcount;
+	int i,icount,jcount;
 	int i1;
-	int x[30];		/* allows for 20 data points with basis function of order 5 */
 	int nplusc;
 
 	T step;
 	T t;
-	T nbasis[20];
+	int span;
+	T* nbasis = work;		/* k nonzero basis values, then the left/right differences */
+	T* left = work + k;
+	T* right = work + 2 * k;
 	T temp;
+	T sum;
 
 
 	nplusc = npts + k;
 
-/*  zero and redimension the knot vector and the basis array */
-
-	for(i = 0; i < npts; i++){
-		 nbasis[i] = 0.;
-	}
+/*  zero and redimension the knot vector */
 
 	for(i = 0; i < nplusc; i++){
 		 x[i] = 0.;
@@ -190,7 +203,8 @@ void rbsplineu(int npts, int k, int p1, T b[], T h[], T p[])
 			t = (T)x[nplusc - 1];
 		}
 
-	    rbasis(k,t,npts,x,h,nbasis);      /* generate the basis function for this value of t */
+		span = find_span(k,t,npts,x);
+	    basis_span(k,t,span,x,nbasis,left,right);      /* generate the k nonzero basis functions for this value of t */
 /*
 		printf("t = %f \n",t);
 		printf("nbasis = ");
@@ -199,19 +213,18 @@ void rbsplineu(int npts, int k, int p1, T b[], T h[], T p[])
 		}
 		printf("\n");
 */
-		for (j = 0; j < 3; j++){      /* generate a point on the curve */
-			jcount = j;
-			p[icount+j] = 0.;
-
-			for (i = 0; i < npts; i++){ /* Do local matrix multiplication */
-				temp = nbasis[i]*b[jcount];
-			    p[icount + j] = p[icount + j] + temp;
-/*
-				printf("jcount,nbasis,b,nbasis*b,p = %d %f %f %f %f\n",jcount,nbasis[i],b[jcount],temp,p[icount+j]);
-*/
-				jcount = jcount + 3;
-			}
+		jcount = 3*(span-k+1);
+		sum = 0.;
+		p[icount] = p[icount+1] = p[icount+2] = 0.;
+		for (i = 0; i < k; i++){
+			temp = nbasis[i]*h[span-k+1+i];
+			p[icount] = p[icount] + temp*b[jcount];
+			p[icount+1] = p[icount+1] + temp*b[jcount+1];
+			p[icount+2] = p[icount+2] + temp*b[jcount+2];
+			sum = sum + temp;
+			jcount = jcount + 3;
 		}
+		project_homogeneous(&p[icount],sum,3,&p[icount]);
 /*
 		printf("icount, p %d %f %f %f \n",icount,p[icount+1],p[icount+2],p[icount+3]);
 */
@@ -220,4 +233,15 @@ void rbsplineu(int npts, int k, int p1, T b[], T h[], T p[])
 	}
 }
 
+/*  Compatibility version of rbsplineu() which allocates x[] and work[] on
+    every call. */
+
+template <typename T>
+void rbsplineu(int npts, int k, int p1, const T b[], const T h[], T p[])
+{
+	std::vector<int> x(bsp_knot_size(npts, k));
+	std::vector<T> work(bsp_work_size(npts, k));
+	rbsplineu(npts, k, p1, b, h, p, x.data(), work.data());
+}
+
 }
\ No newline at end of file
@@ -7,64 +7,17 @@
 #include "bsp_util.h"
 #include "rbsp_util.h"
 
-namespace aitn
-{
-
-/*  Subroutine to calculate the sum of the nonrational basis functions (see \eq {6--87}).
-	
-	Name: sumrbas.c
-	Language: C
-	Subroutines called: none
-	Book reference: Chapter 7, Section 7.1, Alg. p.309
-	
-    b[]         = array containing the polygon net points
-                    b[1] = x-component
-                    b[2] = y-component
-                    b[3] = z-component
-                    b[4] = homogeneous coordinate weighting factor        
-                    Note: Bi,j = b[] has dimensions of n*m x 4 with j varying fastest
-                     The polygon net is n x m
-    mbasis[,]  = array containing the nonrational basis functions for one value of w
-    mpts       = the number of polygon vertices in w direction
-    nbasis[,]  = array containing the nonrational basis functions for one value of u
-    npts       = the number of polygon vertices in u direction
-    sum        = sum of the basis functions
-*/
+#include <vector>
 
-template <typename T>
-T sumrbas(T b[], T nbasis[], T mbasis[], int npts, int mpts)
+namespace aitn
 {
 
-	int i,j,jbas,j1;
-	T sum;
-	
- /* calculate the sum */
-
-	sum = 0;
-/*	printf("npts,mpts %d %d \n", npts,mpts);*/
-
-	for (i = 0; i < npts; i++){
-		if (nbasis[i] != 0.){
-			jbas = 4*mpts*i;
-		    for (j = 0; j < mpts; j++){
-/*				printf("i,j,jbas %d %d %d \n",i,j,jbas);*/
-		    	if (mbasis[j] != 0.){
-		    	    j1 = jbas + 4*j + 3;
-/*					printf("in sumrbas j1 = %d \n",j1);*/
-	    	    	sum = sum + b[j1]*nbasis[i]*mbasis[j];
-				}
-			}
-		}
-	}
-	return(sum);
-}
-
 /*  Subroutine to calculate a Cartesian product rational B-spline
     surface using open uniform knot vectors (see Eq. (7.1)).
 
 	Name: rbspsurf.c
 	Language: C
-	Subroutines called: knot.c, basis.c sumrbas.c
+	Subroutines called: knot.c, find_span, basis_span
 	Book reference: Chapter 7, Section 7.1, Alg. p. 308
 
     b[]         = array containing the polygon net points
@@ -72,8 +25,8 @@ T sumrbas(T b[], T nbasis[], T mbasis[], int npts, int mpts)
                   b[2] = y-component
                   b[3] = z-component
                   b[4] = h-component
-                  Note: Bi,j = b[] has dimensions of n*m*3 with j varying fastest
-                      The polygon net is n x m
+                  Note: Bi,j = b[] has dimensions of n*m*4 with j varying fastest,
+                      rows are m points apart. The polygon net is n x m
     k           = order in the u direction
     l           = order in the w direction
     mbasis[]    = array containing the nonrational basis functions for one value of w (see Eq. (3.2))
@@ -89,24 +42,26 @@ T sumrbas(T b[], T nbasis[], T mbasis[], int npts, int mpts)
                        for a fixed value of u the next m elements contain
                        the values for the curve q[u[sub i],w] q has dimensions
                        of p1*p2*3. The display surface is p1 x p2
+    work[]      = workspace of bspsurf_work_size(npts, mpts, k, l) values
+    x[], y[]    = u and w knot vectors, bsp_knot_size() values each
 */
 
 template <typename T>
-void rbspsurf(T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
+void rbspsurf(const T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[],
+    int x[], int y[], T work[])
 {
 
-/*   allows for 20 data points with basis function of order 5 */
-
     int i,j,j1,jbas;
     int icount;
     int uinc,winc;
     int nplusc,mplusc;
-    int x[30],y[30];
-    int temp;
 
-    T nbasis[30],mbasis[30];
+    int uspan,wspan;
+    T* nbasis = work;            /* k nonzero u basis values */
+    T* mbasis = work + k;        /* l nonzero w basis values */
+    T* left = work + k + l;
+    T* right = left + (k > l ? k : l);
     T pbasis;
-    T h;
     T sum;
     T u,w;
     T stepu,stepw;
@@ -124,14 +79,6 @@ void rbspsurf(T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
     for (i = 0; i < mplusc; i++){
         y[i] = 0;
     }
-    for (i = 0; i < npts; i++){
-        nbasis[i] = 0.;
-    }
-    for (i = 0; i < mpts; i++){
-        mbasis[i] = 0.;
-    }
-
-    temp = 3*(p1*p2);
 
     for (i = 0; i < 3*p1*p2; i++){
         q[i] = 0.;
@@ -154,34 +101,32 @@ void rbspsurf(T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
         if ((T)x[nplusc - 1] - u < 5e-6){
             u = (T)x[nplusc - 1];
         }
-        basis(k,u,npts,x,nbasis);    /* basis function for this value of u */
+        uspan = find_span(k,u,npts,x);
+        basis_span(k,u,uspan,x,nbasis,left,right);    /* nonzero basis functions for this value of u */
         w = 0.;
         for (winc = 0; winc < p2; winc++)
         {
             if ((T)y[mplusc - 1] - w < 5e-6){
                 w = (T)y[mplusc - 1];
             }
-            basis(l,w,mpts,y,mbasis);    /* basis function for this value of w */
-            sum = sumrbas(b,nbasis,mbasis,npts,mpts);
-/*        	printf("in rbspsurf u,w,sum = %f %f %f \n",u,w,sum);*/
-            for (i = 0; i < npts; i++)
+            wspan = find_span(l,w,mpts,y);
+            basis_span(l,w,wspan,y,mbasis,left,right);    /* nonzero basis functions for this value of w */
+            /* the k x l weighted basis sum is the denominator */
+            sum = 0.;
+            for (i = 0; i < k; i++)
             {
-                if (nbasis[i] != 0.)
+                jbas = 4*mpts*(uspan - k + 1 + i) + 4*(wspan - l + 1);
+                for (j = 0; j < l; j++)
                 {
-                    jbas = 4*(mpts + 1)*i;
-                    for (j = 0; j < mpts; j++)
-                    {
-                        if (mbasis[j] != 0.)
-                        {
-                            j1 = jbas +4*j;
-                            pbasis = b[j1+3]*nbasis[i]*mbasis[j]/sum;
-                            q[icount] = q[icount]+b[j1]*pbasis;  /* calculate surface point */
-                            q[icount+1] = q[icount+1]+b[j1+1]*pbasis;
-                            q[icount+2] = q[icount+2]+b[j1+2]*pbasis;
-                        }
-                    }
+                    j1 = jbas + 4*j;
+                    pbasis = b[j1+3]*nbasis[i]*mbasis[j];
+                    q[icount] = q[icount]+b[j1]*pbasis;  /* calculate surface point */
+                    q[icount+1] = q[icount+1]+b[j1+1]*pbasis;
+                    q[icount+2] = q[icount+2]+b[j1+2]*pbasis;
+                    sum = sum + pbasis;
                 }
             }
+            project_homogeneous(&q[icount],sum,3,&q[icount]);
             icount = icount + 3;
             w = w + stepw;
         }
@@ -189,4 +134,15 @@ void rbspsurf(T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
     }
 }
 
+/*  Compatibility version of rbspsurf() which allocates x[] and work[] on
+    every call. */
+
+template <typename T>
+void rbspsurf(const T b[], int k, int l, int npts, int mpts, int p1, int p2, T q[])
+{
+    std::vector<int> x(bsp_knot_size(npts, k)), y(bsp_knot_size(mpts, l));
+    std::vector<T> work(bspsurf_work_size(npts, mpts, k, l));
+    rbspsurf(b, k, l, npts, mpts, p1, p2, q, x.data(), y.data(), work.data());
+}
+
 }
\ No newline at end of file
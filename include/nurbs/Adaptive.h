@@ -0,0 +1,202 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <utility>
+
+namespace nurbs
+{
+
+// Stop splitting a parameter interval once both hold for its midpoint.
+struct AdaptiveTolerance
+{
+	double chord = 1e-3;	// max distance of the midpoint from the chord
+	double angle = 0.1;		// max turn in radians at the midpoint, 0 to ignore
+	int max_depth = 12;		// max splits below each seed interval
+};
+
+// Triangle mesh from NurbsSurface::TessellateAdaptive.
+template <typename T>
+struct AdaptiveMesh
+{
+	std::vector<T> points;		// x, y, z per vertex
+	std::vector<T> params;		// u, w per vertex
+	std::vector<int> triangles;	// 3 vertex indices each, ccw in (u, w)
+
+	int GetVertexNum() const { return static_cast<int>(points.size() / 3); }
+	int GetTriangleNum() const { return static_cast<int>(triangles.size() / 3); }
+
+	void Clear() { points.clear(); params.clear(); triangles.clear(); }
+};
+
+// seed intervals per nonzero knot span
+inline int adaptive_pieces(int order)
+{
+	return order - 1 > 2 ? order - 1 : 2;
+}
+
+// Initial intervals: every nonzero knot span cut into max(2, order - 1)
+// pieces, so a single midpoint test cannot miss an inflection.
+template <typename T>
+void adaptive_seeds(int order, int npts, const std::vector<T>& knots, std::vector<T>& seeds)
+{
+	const int pieces = adaptive_pieces(order);
+	seeds.clear();
+	seeds.push_back(knots[order - 1]);
+	for (int i = order - 1; i < npts; ++i)
+	{
+		const T t0 = knots[i], t1 = knots[i + 1];
+		if (t1 <= t0) {
+			continue;
+		}
+		for (int j = 1; j < pieces; ++j) {
+			seeds.push_back(t0 + (t1 - t0) * j / pieces);
+		}
+		seeds.push_back(t1);
+	}
+}
+
+// p0, p1 are the ends of an interval and pm the point at its middle
+template <typename T>
+bool adaptive_flat(const T* p0, const T* pm, const T* p1, double chord, double cos_angle)
+{
+	double v[3], d0[3], d1[3];
+	for (int c = 0; c < 3; ++c)
+	{
+		v[c]  = static_cast<double>(p1[c]) - p0[c];
+		d0[c] = static_cast<double>(pm[c]) - p0[c];
+		d1[c] = static_cast<double>(p1[c]) - pm[c];
+	}
+
+	// distance from the chord segment
+	const double len2 = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+	double s = len2 > 0 ? (d0[0] * v[0] + d0[1] * v[1] + d0[2] * v[2]) / len2 : 0;
+	s = s < 0 ? 0 : (s > 1 ? 1 : s);
+	double dist2 = 0;
+	for (int c = 0; c < 3; ++c) {
+		const double e = d0[c] - s * v[c];
+		dist2 += e * e;
+	}
+	if (dist2 > chord * chord) {
+		return false;
+	}
+
+	if (cos_angle < 1)
+	{
+		const double l0 = d0[0] * d0[0] + d0[1] * d0[1] + d0[2] * d0[2];
+		const double l1 = d1[0] * d1[0] + d1[1] * d1[1] + d1[2] * d1[2];
+		if (l0 > 0 && l1 > 0)
+		{
+			const double dot = d0[0] * d1[0] + d0[1] * d1[1] + d0[2] * d1[2];
+			if (dot < cos_angle * std::sqrt(l0 * l1)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+template <typename T, typename F>
+struct AdaptiveRefine
+{
+	const F& eval;
+	std::vector<T>& params;
+	std::vector<T>* samples;
+
+	int stride, max_depth;
+	double chord, cos_angle;
+
+	// one midpoint buffer per level, then one for the quarter points
+	T* levels;
+	T* quarter;
+
+	void Emit(T t, const T* s) const
+	{
+		params.push_back(t);
+		if (samples) {
+			samples->insert(samples->end(), s, s + stride);
+		}
+	}
+
+	bool IsFlat(const T* s0, const T* sm, const T* s1) const
+	{
+		for (int i = 0; i < stride; i += 3) {
+			if (!adaptive_flat(s0 + i, sm + i, s1 + i, chord, cos_angle)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// A midpoint on the chord can hide an S, as a cubic piece turns both
+	// ways; the quarter points catch that.
+	bool IsNearChord(T t0, const T* s0, T t1, const T* s1) const
+	{
+		for (int q = 1; q <= 3; q += 2)
+		{
+			eval(t0 + (t1 - t0) * q / 4, quarter);
+			for (int i = 0; i < stride; i += 3) {
+				if (!adaptive_flat(s0 + i, quarter + i, s1 + i, chord, 1.0)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// emits t1 and every split point inside (t0, t1)
+	void Split(T t0, const T* s0, T t1, const T* s1, int depth) const
+	{
+		const T tm = t0 + (t1 - t0) / 2;
+		T* sm = levels + depth * stride;
+		eval(tm, sm);
+		if (depth >= max_depth || (IsFlat(s0, sm, s1) && IsNearChord(t0, s0, t1, s1))) {
+			Emit(t1, s1);
+			return;
+		}
+		Split(t0, s0, tm, sm, depth + 1);
+		Split(tm, sm, t1, s1, depth + 1);
+	}
+
+}; // AdaptiveRefine
+
+// Refine the seed intervals by recursive bisection. eval(t, out) writes
+// `count` points (3 values each) and an interval is split while any of
+// them fails adaptive_flat() at its midpoint or strays from the chord at
+// its quarter points. params gets the seeds plus every split
+// point in order, samples (if not null) the matching eval() output.
+template <typename T, typename F>
+void adaptive_params(const std::vector<T>& seeds, int count, const F& eval,
+	                 const AdaptiveTolerance& tol, std::vector<T>& params, std::vector<T>* samples = nullptr)
+{
+	params.clear();
+	if (samples) {
+		samples->clear();
+	}
+	if (seeds.empty()) {
+		return;
+	}
+
+	const int stride = count * 3;
+	const int max_depth = tol.max_depth > 0 ? tol.max_depth : 0;
+
+	// interval start, interval end, a midpoint per level and a quarter point
+	std::vector<T> buf(stride * (max_depth + 4));
+
+	AdaptiveRefine<T, F> refine{ eval, params, samples, stride, max_depth,
+		tol.chord, tol.angle > 0 ? std::cos(tol.angle) : 1.0, &buf[stride * 2],
+		&buf[stride * (max_depth + 3)] };
+
+	T* s0 = &buf[0];
+	T* s1 = &buf[stride];
+	eval(seeds[0], s0);
+	refine.Emit(seeds[0], s0);
+	for (size_t i = 1; i < seeds.size(); ++i)
+	{
+		eval(seeds[i], s1);
+		refine.Split(seeds[i - 1], s0, seeds[i], s1, 0);
+		std::swap(s0, s1);
+	}
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+namespace nurbs
+{
+
+class TessPlan;
+
+enum class SimdLevel
+{
+	Scalar,
+	SSE,		// 4 samples per step
+	AVX2,		// 8 samples per step
+	AVX512,		// 16 samples per step
+};
+
+// highest level supported by this CPU, checked once
+SimdLevel simd_detect();
+const char* simd_name(SimdLevel level);
+
+// Evaluate all samples of a plan from structure-of-arrays control points
+// into structure-of-arrays output, several samples per instruction.
+// z / out_z may be null for 2D data.
+//
+// Each lane performs the same k multiplies and adds, in the same order, as
+// the scalar kernel, so every level returns the Scalar result bit for bit
+// unless the compiler contracts the scalar code into fused multiply-adds;
+// in that case the difference is bounded by k ULP of the largest
+// |basis * control| term.
+void batch_eval(const TessPlan& plan, const float* x, const float* y, const float* z,
+	float* out_x, float* out_y, float* out_z, SimdLevel level = simd_detect());
+
+// Tensor-product surface from a u_plan.npts x w_plan.npts net (w varying
+// fastest) into u samples x w samples outputs. Evaluated as a curve in u
+// per row of the net, then a curve in w; work holds 3 * w_plan npts floats.
+// Same bound as batch_eval against the Scalar level; against
+// TessPlan::EvalSurface the summation order differs, (k + l) ULP.
+void batch_eval_surface(const TessPlan& u_plan, const TessPlan& w_plan,
+	const float* x, const float* y, const float* z,
+	float* out_x, float* out_y, float* out_z, float* work,
+	SimdLevel level = simd_detect());
+
+// Rational versions, h holds the weights. The control points are scaled
+// into homogeneous (hx, hy, hz) and run with h through the non-rational
+// kernels above, then each output point is divided once by its h sum.
+// work holds 3 * npts + samples floats for a curve and
+// 3 * npts * mpts + u samples * w samples + 4 * mpts for a surface.
+void batch_eval_rational(const TessPlan& plan, const float* x, const float* y, const float* z,
+	const float* h, float* out_x, float* out_y, float* out_z, float* work,
+	SimdLevel level = simd_detect());
+void batch_eval_surface_rational(const TessPlan& u_plan, const TessPlan& w_plan,
+	const float* x, const float* y, const float* z, const float* h,
+	float* out_x, float* out_y, float* out_z, float* work,
+	SimdLevel level = simd_detect());
+
+}
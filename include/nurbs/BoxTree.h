@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+namespace nurbs
+{
+
+// Bounding volume hierarchy over axis-aligned boxes: built once by median
+// splits along the longest axis, one box per leaf, then queried for the
+// boxes near a point with the nearer child always visited first.
+template <typename T>
+class BoxTree
+{
+public:
+	// count boxes of (min x, y, z, max x, y, z), item i is the i-th box
+	void Build(const T* boxes, int count);
+
+	bool IsEmpty() const { return m_nodes.empty(); }
+
+	// Calls bound = visit(item, dist2) for the items whose box is within
+	// sqrt(bound) of p, where dist2 is the squared distance of p to the
+	// box. Subtrees no nearer than the bound returned so far are skipped.
+	template <typename Visit>
+	void Nearest(const T* p, T bound, Visit visit) const;
+
+	// squared distance of p to the box, 0 inside
+	static T Dist2(const T* box, const T* p);
+
+private:
+	void BuildNode(int node, const T* boxes, std::vector<int>& items, int begin, int end);
+
+private:
+	struct Node
+	{
+		T box[6];
+		int child;	// index of the first of two children, -1 for a leaf
+		int item;
+	};
+
+	std::vector<Node> m_nodes;
+
+}; // BoxTree
+
+}
+
+#include "nurbs/BoxTree.inl"
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+
+namespace nurbs
+{
+
+template <typename T>
+void BoxTree<T>::Build(const T* boxes, int count)
+{
+	m_nodes.clear();
+	if (count <= 0) {
+		return;
+	}
+
+	std::vector<int> items(count);
+	for (int i = 0; i < count; ++i) {
+		items[i] = i;
+	}
+	m_nodes.reserve(2 * count - 1);
+	m_nodes.resize(1);
+	BuildNode(0, boxes, items, 0, count);
+}
+
+template <typename T>
+template <typename Visit>
+void BoxTree<T>::Nearest(const T* p, T bound, Visit visit) const
+{
+	if (m_nodes.empty()) {
+		return;
+	}
+
+	// median splits keep the depth at log2(count), far below this
+	const int MAX_STACK = 64;
+	int stack[MAX_STACK];
+	T dists[MAX_STACK];
+	int top = 0;
+
+	const T root = Dist2(m_nodes[0].box, p);
+	if (root < bound) {
+		stack[top] = 0;
+		dists[top++] = root;
+	}
+	while (top > 0)
+	{
+		--top;
+		const Node& node = m_nodes[stack[top]];
+		const T dist2 = dists[top];
+		// the bound may have shrunk since this was pushed
+		if (dist2 >= bound) {
+			continue;
+		}
+
+		if (node.child < 0) {
+			bound = visit(node.item, dist2);
+			continue;
+		}
+
+		int near = node.child, far = node.child + 1;
+		T dnear = Dist2(m_nodes[near].box, p);
+		T dfar  = Dist2(m_nodes[far].box, p);
+		if (dfar < dnear) {
+			std::swap(near, far);
+			std::swap(dnear, dfar);
+		}
+		if (dfar < bound) {
+			stack[top] = far;
+			dists[top++] = dfar;
+		}
+		if (dnear < bound) {
+			stack[top] = near;
+			dists[top++] = dnear;
+		}
+	}
+}
+
+template <typename T>
+T BoxTree<T>::Dist2(const T* box, const T* p)
+{
+	T dist2 = 0;
+	for (int c = 0; c < 3; ++c)
+	{
+		T d = 0;
+		if (p[c] < box[c]) {
+			d = box[c] - p[c];
+		} else if (p[c] > box[3 + c]) {
+			d = p[c] - box[3 + c];
+		}
+		dist2 += d * d;
+	}
+	return dist2;
+}
+
+template <typename T>
+void BoxTree<T>::BuildNode(int node, const T* boxes, std::vector<int>& items, int begin, int end)
+{
+	T box[6];
+	for (int c = 0; c < 6; ++c) {
+		box[c] = boxes[items[begin] * 6 + c];
+	}
+	for (int i = begin + 1; i < end; ++i)
+	{
+		const T* b = &boxes[items[i] * 6];
+		for (int c = 0; c < 3; ++c) {
+			box[c] = std::min(box[c], b[c]);
+			box[3 + c] = std::max(box[3 + c], b[3 + c]);
+		}
+	}
+	std::copy(box, box + 6, m_nodes[node].box);
+
+	if (end - begin == 1) {
+		m_nodes[node].child = -1;
+		m_nodes[node].item = items[begin];
+		return;
+	}
+
+	int axis = 0;
+	for (int c = 1; c < 3; ++c) {
+		if (box[3 + c] - box[c] > box[3 + axis] - box[axis]) {
+			axis = c;
+		}
+	}
+	const int mid = (begin + end) / 2;
+	std::nth_element(items.begin() + begin, items.begin() + mid, items.begin() + end,
+		[&](int a, int b) {
+			return boxes[a * 6 + axis] + boxes[a * 6 + 3 + axis]
+				< boxes[b * 6 + axis] + boxes[b * 6 + 3 + axis];
+		});
+
+	const int child = static_cast<int>(m_nodes.size());
+	m_nodes.resize(child + 2);
+	m_nodes[node].child = child;
+	m_nodes[node].item = -1;
+	BuildNode(child, boxes, items, begin, mid);
+	BuildNode(child + 1, boxes, items, mid, end);
+}
+
+}
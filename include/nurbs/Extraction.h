@@ -0,0 +1,127 @@
+#pragma once
+
+#include "nurbs/NurbsCurve.h"
+#include "nurbs/NurbsSurface.h"
+
+#include <vector>
+
+namespace nurbs
+{
+
+// Bezier extraction operators of one knot vector. Inserting the two end
+// knots of a span (Boehm) until both have multiplicity order - 1 turns its
+// order points into the Bezier points of that span; the new points are
+// linear in the old ones, so each nonempty span keeps an order x order
+// matrix that depends on the knots alone.
+template <typename T>
+class BezierOperators
+{
+public:
+	BezierOperators();
+
+	// false when order and knots are those of the last call and the
+	// operators were kept
+	bool Build(int order, int npts, const std::vector<T>& knots);
+
+	int GetOrder() const { return m_order; }
+	// number of nonempty spans
+	int GetNum() const { return static_cast<int>(m_spans.size()); }
+
+	// knot span of segment s, from order - 1 to npts - 1, and its range
+	int GetSpan(int s) const { return m_spans[s]; }
+	void GetRange(int s, T& min, T& max) const;
+
+	// Row j holds the weights of the span's order points, the first being
+	// point GetSpan(s) - order + 1, in Bezier point j.
+	const T* GetMatrix(int s) const { return &m_matrices[s * m_order * m_order]; }
+
+private:
+	int m_order;
+	int m_npts;
+	std::vector<T> m_knots;
+
+	std::vector<int> m_spans;
+	std::vector<T> m_matrices;
+
+}; // BezierOperators
+
+// Bezier form of a curve: one segment per nonempty knot span, `order`
+// homogeneous points (wx, wy, wz, w) each, all in one contiguous array.
+// Extract() again after moving control points only multiplies out the
+// operators; they are rebuilt when the order or the knots changed.
+template <typename T>
+class BezierSegments
+{
+public:
+	BezierSegments() {}
+	explicit BezierSegments(const NurbsCurve<T>& curve);
+
+	void Extract(const NurbsCurve<T>& curve);
+
+	int GetOrder() const { return m_ops.GetOrder(); }
+	int GetNum() const { return m_ops.GetNum(); }
+
+	int GetSpan(int s) const { return m_ops.GetSpan(s); }
+	void GetRange(int s, T& min, T& max) const { m_ops.GetRange(s, min, max); }
+
+	// order points of segment s
+	const T* GetPoints(int s) const { return &m_points[s * GetOrder() * 4]; }
+	// GetNum() * order * 4 values
+	const std::vector<T>& GetAllPoints() const { return m_points; }
+
+	// samples points evenly spaced over each segment, both ends included;
+	// out holds GetNum() * samples * 3, segment by segment. Orders 2 to 4
+	// run a kernel compiled for that degree.
+	void Evaluate(int samples, T* out) const;
+
+private:
+	BezierOperators<T> m_ops;
+
+	std::vector<T> m_points;
+
+}; // BezierSegments
+
+// Bezier form of a surface: a patch per pair of nonempty spans, extracted
+// in u and then in w. Patches are stored one after the other, w span
+// varying fastest, each order_u x order_w points with w varying fastest.
+template <typename T>
+class BezierPatches
+{
+public:
+	BezierPatches() {}
+	explicit BezierPatches(const NurbsSurface<T>& surface);
+
+	void Extract(const NurbsSurface<T>& surface);
+
+	int GetOrderU() const { return m_ops_u.GetOrder(); }
+	int GetOrderW() const { return m_ops_w.GetOrder(); }
+	// patches in each direction
+	int GetNumU() const { return m_ops_u.GetNum(); }
+	int GetNumW() const { return m_ops_w.GetNum(); }
+
+	int GetSpanU(int su) const { return m_ops_u.GetSpan(su); }
+	int GetSpanW(int sw) const { return m_ops_w.GetSpan(sw); }
+	void GetRangeU(int su, T& min, T& max) const { m_ops_u.GetRange(su, min, max); }
+	void GetRangeW(int sw, T& min, T& max) const { m_ops_w.GetRange(sw, min, max); }
+
+	const T* GetPoints(int su, int sw) const;
+	const std::vector<T>& GetAllPoints() const { return m_points; }
+
+	// p1 x p2 points evenly spaced over each patch, edges included, w
+	// varying fastest; out holds GetNumU() * GetNumW() * p1 * p2 * 3.
+	// Orders 2 to 4 in both directions run a kernel compiled for them.
+	void Evaluate(int p1, int p2, T* out) const;
+
+private:
+	BezierOperators<T> m_ops_u, m_ops_w;
+
+	std::vector<T> m_points;
+
+	// Extract() scratch, kept so that re-extracting allocates nothing
+	std::vector<T> m_work;
+
+}; // BezierPatches
+
+}
+
+#include "nurbs/Extraction.inl"
@@ -0,0 +1,364 @@
+#pragma once
+
+#include "../../external/aitn/bezier_util.h"
+#include "../../external/aitn/rbsp_util.h"
+
+#include <algorithm>
+
+namespace nurbs
+{
+
+// samples points of each of num segments, Horner of compile-time degree
+template <int K, typename T>
+void extract_eval_segments(const T* points, int num, int samples, T* out)
+{
+	for (int s = 0; s < num; ++s)
+	{
+		const T* b = points + s * K * 4;
+		for (int i = 0; i < samples; ++i)
+		{
+			const T t = i == samples - 1 ? T(1) : T(i) / (samples - 1);
+			T h[4];
+			aitn::bezier_point<T, 4, K - 1>(b, t, h);
+			T* p = out + (s * samples + i) * 3;
+			aitn::project_homogeneous(h, h[3], 3, p);
+		}
+	}
+}
+
+template <typename T>
+void extract_eval_segments(int order, const T* points, int num, int samples, T* out)
+{
+	for (int s = 0; s < num; ++s)
+	{
+		const T* b = points + s * order * 4;
+		for (int i = 0; i < samples; ++i)
+		{
+			const T t = i == samples - 1 ? T(1) : T(i) / (samples - 1);
+			T h[4];
+			aitn::bezier_point<T, 4>(order, b, t, h);
+			T* p = out + (s * samples + i) * 3;
+			aitn::project_homogeneous(h, h[3], 3, p);
+		}
+	}
+}
+
+// p1 x p2 points of each of num patches: per w sample the K rows collapse
+// to one Bezier curve in u, which gives all u samples of that column
+template <int K, int L, typename T>
+void extract_eval_patches(const T* points, int num, int p1, int p2, T* out)
+{
+	for (int patch = 0; patch < num; ++patch)
+	{
+		const T* b = points + patch * K * L * 4;
+		for (int iw = 0; iw < p2; ++iw)
+		{
+			const T w = iw == p2 - 1 ? T(1) : T(iw) / (p2 - 1);
+			T col[K * 4];
+			for (int i = 0; i < K; ++i) {
+				aitn::bezier_point<T, 4, L - 1>(b + i * L * 4, w, col + i * 4);
+			}
+			for (int iu = 0; iu < p1; ++iu)
+			{
+				const T u = iu == p1 - 1 ? T(1) : T(iu) / (p1 - 1);
+				T h[4];
+				aitn::bezier_point<T, 4, K - 1>(col, u, h);
+				T* p = out + ((patch * p1 + iu) * p2 + iw) * 3;
+				aitn::project_homogeneous(h, h[3], 3, p);
+			}
+		}
+	}
+}
+
+template <typename T>
+void extract_eval_patches(int k, int l, const T* points, int num, int p1, int p2, T* out)
+{
+	std::vector<T> col(k * 4);
+	for (int patch = 0; patch < num; ++patch)
+	{
+		const T* b = points + patch * k * l * 4;
+		for (int iw = 0; iw < p2; ++iw)
+		{
+			const T w = iw == p2 - 1 ? T(1) : T(iw) / (p2 - 1);
+			for (int i = 0; i < k; ++i) {
+				aitn::bezier_point<T, 4>(l, b + i * l * 4, w, &col[i * 4]);
+			}
+			for (int iu = 0; iu < p1; ++iu)
+			{
+				const T u = iu == p1 - 1 ? T(1) : T(iu) / (p1 - 1);
+				T h[4];
+				aitn::bezier_point<T, 4>(k, col.data(), u, h);
+				T* p = out + ((patch * p1 + iu) * p2 + iw) * 3;
+				aitn::project_homogeneous(h, h[3], 3, p);
+			}
+		}
+	}
+}
+
+template <int K, typename T>
+void extract_eval_patches_w(int l, const T* points, int num, int p1, int p2, T* out)
+{
+	switch (l)
+	{
+	case 2:
+		extract_eval_patches<K, 2>(points, num, p1, p2, out);
+		break;
+	case 3:
+		extract_eval_patches<K, 3>(points, num, p1, p2, out);
+		break;
+	case 4:
+		extract_eval_patches<K, 4>(points, num, p1, p2, out);
+		break;
+	default:
+		extract_eval_patches(K, l, points, num, p1, p2, out);
+	}
+}
+
+template <typename T>
+BezierOperators<T>::BezierOperators()
+	: m_order(0)
+	, m_npts(0)
+{
+}
+
+template <typename T>
+bool BezierOperators<T>::Build(int order, int npts, const std::vector<T>& knots)
+{
+	if (order == m_order && npts == m_npts && knots == m_knots) {
+		return false;
+	}
+
+	m_order = order;
+	m_npts = npts;
+	m_knots = knots;
+	m_spans.clear();
+	m_matrices.clear();
+
+	// Bezier point j is the span polynomial blossomed at j arguments b and
+	// the others a: the de Boor scheme with level r at a or b, where each
+	// level inserts one knot. Run on the unit vectors, only when the knots
+	// change.
+	const int deg = order - 1;
+	std::vector<T> work(order * order);
+	for (int span = deg; span < npts; ++span)
+	{
+		const T a = knots[span], b = knots[span + 1];
+		if (b <= a) {
+			continue;
+		}
+
+		m_spans.push_back(span);
+		m_matrices.resize(m_matrices.size() + order * order);
+		T* m = &m_matrices[m_matrices.size() - order * order];
+		for (int j = 0; j <= deg; ++j)
+		{
+			std::fill(work.begin(), work.end(), T(0));
+			for (int i = 0; i <= deg; ++i) {
+				work[i * order + i] = 1;
+			}
+			for (int r = 1; r <= deg; ++r)
+			{
+				const T t = r <= deg - j ? a : b;
+				for (int i = deg; i >= r; --i)
+				{
+					const T lo = knots[span - deg + i];
+					const T alpha = (t - lo) / (knots[span + 1 + i - r] - lo);
+					T* row = &work[i * order];
+					const T* prev = row - order;
+					for (int c = 0; c < order; ++c) {
+						row[c] = (1 - alpha) * prev[c] + alpha * row[c];
+					}
+				}
+			}
+			std::copy(work.begin() + deg * order, work.end(), m + j * order);
+		}
+	}
+	return true;
+}
+
+template <typename T>
+void BezierOperators<T>::GetRange(int s, T& min, T& max) const
+{
+	min = m_knots[m_spans[s]];
+	max = m_knots[m_spans[s] + 1];
+}
+
+template <typename T>
+BezierSegments<T>::BezierSegments(const NurbsCurve<T>& curve)
+{
+	Extract(curve);
+}
+
+template <typename T>
+void BezierSegments<T>::Extract(const NurbsCurve<T>& curve)
+{
+	if (!curve.IsValid())
+	{
+		m_ops = BezierOperators<T>();
+		m_points.clear();
+		return;
+	}
+
+	const int k = curve.GetOrder();
+	m_ops.Build(k, curve.GetNum(), curve.GetKnots());
+
+	const int num = m_ops.GetNum();
+	m_points.resize(num * k * 4);
+	for (int s = 0; s < num; ++s)
+	{
+		const int first = m_ops.GetSpan(s) - k + 1;
+		const T* m = m_ops.GetMatrix(s);
+		T* dst = &m_points[s * k * 4];
+		std::fill(dst, dst + k * 4, T(0));
+		for (int i = 0; i < k; ++i)
+		{
+			const T* p = curve.GetControlPoint(first + i);
+			const T w = curve.GetWeight(first + i);
+			const T h[4] = { p[0] * w, p[1] * w, p[2] * w, w };
+			for (int j = 0; j < k; ++j)
+			{
+				const T c = m[j * k + i];
+				for (int d = 0; d < 4; ++d) {
+					dst[j * 4 + d] += c * h[d];
+				}
+			}
+		}
+	}
+}
+
+template <typename T>
+void BezierSegments<T>::Evaluate(int samples, T* out) const
+{
+	if (samples < 2 || m_points.empty()) {
+		return;
+	}
+
+	const int num = GetNum();
+	switch (GetOrder())
+	{
+	case 2:
+		extract_eval_segments<2>(m_points.data(), num, samples, out);
+		break;
+	case 3:
+		extract_eval_segments<3>(m_points.data(), num, samples, out);
+		break;
+	case 4:
+		extract_eval_segments<4>(m_points.data(), num, samples, out);
+		break;
+	default:
+		extract_eval_segments(GetOrder(), m_points.data(), num, samples, out);
+	}
+}
+
+template <typename T>
+BezierPatches<T>::BezierPatches(const NurbsSurface<T>& surface)
+{
+	Extract(surface);
+}
+
+template <typename T>
+void BezierPatches<T>::Extract(const NurbsSurface<T>& surface)
+{
+	if (!surface.IsValid())
+	{
+		m_ops_u = BezierOperators<T>();
+		m_ops_w = BezierOperators<T>();
+		m_points.clear();
+		return;
+	}
+
+	const int k = surface.GetOrderU();
+	const int l = surface.GetOrderW();
+	m_ops_u.Build(k, surface.GetNumU(), surface.GetKnotsU());
+	m_ops_w.Build(l, surface.GetNumW(), surface.GetKnotsW());
+
+	const int nu = m_ops_u.GetNum();
+	const int nw = m_ops_w.GetNum();
+	m_points.resize(nu * nw * k * l * 4);
+
+	// the block of one patch in homogeneous form, then its u rows
+	m_work.resize(2 * k * l * 4);
+	T* block = m_work.data();
+	T* rows = block + k * l * 4;
+	for (int su = 0; su < nu; ++su)
+	{
+		const int first_u = m_ops_u.GetSpan(su) - k + 1;
+		const T* mu = m_ops_u.GetMatrix(su);
+		for (int sw = 0; sw < nw; ++sw)
+		{
+			const int first_w = m_ops_w.GetSpan(sw) - l + 1;
+			const T* mw = m_ops_w.GetMatrix(sw);
+
+			for (int i = 0; i < k; ++i)
+			{
+				for (int j = 0; j < l; ++j)
+				{
+					const T* p = surface.GetControlPoint(first_u + i, first_w + j);
+					const T w = surface.GetWeight(first_u + i, first_w + j);
+					T* h = &block[(i * l + j) * 4];
+					h[0] = p[0] * w;
+					h[1] = p[1] * w;
+					h[2] = p[2] * w;
+					h[3] = w;
+				}
+			}
+
+			std::fill(rows, rows + k * l * 4, T(0));
+			for (int a = 0; a < k; ++a) {
+				for (int i = 0; i < k; ++i) {
+					const T c = mu[a * k + i];
+					for (int v = 0; v < l * 4; ++v) {
+						rows[a * l * 4 + v] += c * block[i * l * 4 + v];
+					}
+				}
+			}
+
+			T* dst = &m_points[(su * nw + sw) * k * l * 4];
+			std::fill(dst, dst + k * l * 4, T(0));
+			for (int a = 0; a < k; ++a) {
+				for (int b = 0; b < l; ++b) {
+					for (int j = 0; j < l; ++j) {
+						const T c = mw[b * l + j];
+						for (int d = 0; d < 4; ++d) {
+							dst[(a * l + b) * 4 + d] += c * rows[(a * l + j) * 4 + d];
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+template <typename T>
+const T* BezierPatches<T>::GetPoints(int su, int sw) const
+{
+	const int size = GetOrderU() * GetOrderW() * 4;
+	return &m_points[(su * GetNumW() + sw) * size];
+}
+
+template <typename T>
+void BezierPatches<T>::Evaluate(int p1, int p2, T* out) const
+{
+	if (p1 < 2 || p2 < 2 || m_points.empty()) {
+		return;
+	}
+
+	const int num = GetNumU() * GetNumW();
+	const T* points = m_points.data();
+	switch (GetOrderU())
+	{
+	case 2:
+		extract_eval_patches_w<2>(GetOrderW(), points, num, p1, p2, out);
+		break;
+	case 3:
+		extract_eval_patches_w<3>(GetOrderW(), points, num, p1, p2, out);
+		break;
+	case 4:
+		extract_eval_patches_w<4>(GetOrderW(), points, num, p1, p2, out);
+		break;
+	default:
+		extract_eval_patches(GetOrderU(), GetOrderW(), points, num, p1, p2, out);
+	}
+}
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "nurbs/NurbsCurve.h"
+#include "nurbs/NurbsSurface.h"
+
+#include <vector>
+
+namespace nurbs
+{
+
+// Fixed-resolution tessellation of a curve that is kept up to date as
+// control points move. A control point i only reaches the samples whose
+// `order` nonzero basis values start in [i - order + 1, i], so Update()
+// re-evaluates just those and leaves the rest of the buffer alone.
+template <typename T>
+class IncrementalCurve
+{
+public:
+	IncrementalCurve(const NurbsCurve<T>& curve, int samples);
+
+	const NurbsCurve<T>& GetCurve() const { return m_curve; }
+
+	// change the curve and remember which points moved
+	void SetControlPoint(int i, const T* xyz);
+	void SetWeight(int i, T w);
+
+	// re-evaluate the samples reached by the points changed since the
+	// last call, false if there was nothing to do
+	bool Update();
+
+	int GetSampleNum() const { return m_samples; }
+	// samples * 3 values
+	const T* GetPoints() const { return m_points.data(); }
+
+	// samples [begin, end) rewritten by the last Update(), empty if none
+	void GetDirtyRange(int& begin, int& end) const { begin = m_dirty_begin; end = m_dirty_end; }
+
+private:
+	void MarkDirty(int i);
+
+	void EvalSamples(int begin, int end);
+
+private:
+	NurbsCurve<T> m_curve;
+	int m_samples;
+
+	std::vector<int> m_starts;
+	std::vector<T> m_basis;
+
+	std::vector<T> m_points;
+
+	// changed control points, empty when min > max
+	int m_ctrl_min, m_ctrl_max;
+
+	int m_dirty_begin, m_dirty_end;
+
+}; // IncrementalCurve
+
+// Surface version, a control point (i, j) reaches an order_u x order_w
+// block of spans so the rewritten samples form a rectangle of the grid.
+// Several edits between updates are merged into their bounding box.
+template <typename T>
+class IncrementalSurface
+{
+public:
+	IncrementalSurface(const NurbsSurface<T>& surface, int p1, int p2);
+
+	const NurbsSurface<T>& GetSurface() const { return m_surface; }
+
+	void SetControlPoint(int i, int j, const T* xyz);
+	void SetWeight(int i, int j, T w);
+
+	bool Update();
+
+	int GetNumU() const { return m_p1; }
+	int GetNumW() const { return m_p2; }
+	// p1 * p2 * 3 values, w varying fastest
+	const T* GetPoints() const { return m_points.data(); }
+
+	// Grid rectangle rewritten by the last Update(). Rows u_begin to
+	// u_end - 1 are one contiguous range of the buffer.
+	void GetDirtyRange(int& u_begin, int& u_end, int& w_begin, int& w_end) const;
+
+private:
+	void MarkDirty(int i, int j);
+
+	void EvalSamples(int u_begin, int u_end, int w_begin, int w_end);
+
+private:
+	NurbsSurface<T> m_surface;
+	int m_p1, m_p2;
+
+	std::vector<int> m_ustarts, m_wstarts;
+	std::vector<T> m_ubasis, m_wbasis;
+
+	std::vector<T> m_points;
+
+	int m_ctrl_min[2], m_ctrl_max[2];
+
+	int m_dirty_begin[2], m_dirty_end[2];
+
+}; // IncrementalSurface
+
+}
+
+#include "nurbs/Incremental.inl"
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+
+namespace nurbs
+{
+
+// samples whose basis rows start in [first, last]
+inline void sample_range(const std::vector<int>& starts, int first, int last, int& begin, int& end)
+{
+	begin = static_cast<int>(std::lower_bound(starts.begin(), starts.end(), first) - starts.begin());
+	end = static_cast<int>(std::upper_bound(starts.begin(), starts.end(), last) - starts.begin());
+}
+
+template <typename T>
+IncrementalCurve<T>::IncrementalCurve(const NurbsCurve<T>& curve, int samples)
+	: m_curve(curve)
+	, m_samples(0)
+	, m_ctrl_min(INT_MAX)
+	, m_ctrl_max(INT_MIN)
+	, m_dirty_begin(0)
+	, m_dirty_end(0)
+{
+	if (samples < 2 || !curve.IsValid()) {
+		return;
+	}
+
+	m_samples = samples;
+	NurbsCurve<T>::SampleBasis(curve.GetOrder(), curve.GetNum(), curve.GetKnots(),
+		samples, m_starts, m_basis);
+	m_points.resize(samples * 3);
+
+	m_ctrl_min = 0;
+	m_ctrl_max = curve.GetNum() - 1;
+	Update();
+}
+
+template <typename T>
+void IncrementalCurve<T>::SetControlPoint(int i, const T* xyz)
+{
+	m_curve.SetControlPoint(i, xyz);
+	MarkDirty(i);
+}
+
+template <typename T>
+void IncrementalCurve<T>::SetWeight(int i, T w)
+{
+	// the first weight makes the curve rational and changes every sample
+	if (!m_curve.IsRational() && w != T(1)) {
+		m_ctrl_min = 0;
+		m_ctrl_max = m_curve.GetNum() - 1;
+	}
+	m_curve.SetWeight(i, w);
+	MarkDirty(i);
+}
+
+template <typename T>
+bool IncrementalCurve<T>::Update()
+{
+	m_dirty_begin = m_dirty_end = 0;
+	if (m_samples == 0 || m_ctrl_min > m_ctrl_max) {
+		return false;
+	}
+
+	const int k = m_curve.GetOrder();
+	sample_range(m_starts, m_ctrl_min - k + 1, m_ctrl_max, m_dirty_begin, m_dirty_end);
+	EvalSamples(m_dirty_begin, m_dirty_end);
+
+	m_ctrl_min = INT_MAX;
+	m_ctrl_max = INT_MIN;
+	return m_dirty_begin < m_dirty_end;
+}
+
+template <typename T>
+void IncrementalCurve<T>::MarkDirty(int i)
+{
+	m_ctrl_min = std::min(m_ctrl_min, i);
+	m_ctrl_max = std::max(m_ctrl_max, i);
+}
+
+template <typename T>
+void IncrementalCurve<T>::EvalSamples(int begin, int end)
+{
+	const int k = m_curve.GetOrder();
+	for (int s = begin; s < end; ++s) {
+		m_curve.EvaluateSpan(m_starts[s], &m_basis[s * k], &m_points[s * 3]);
+	}
+}
+
+template <typename T>
+IncrementalSurface<T>::IncrementalSurface(const NurbsSurface<T>& surface, int p1, int p2)
+	: m_surface(surface)
+	, m_p1(0)
+	, m_p2(0)
+{
+	m_ctrl_min[0] = m_ctrl_min[1] = INT_MAX;
+	m_ctrl_max[0] = m_ctrl_max[1] = INT_MIN;
+	m_dirty_begin[0] = m_dirty_begin[1] = 0;
+	m_dirty_end[0] = m_dirty_end[1] = 0;
+
+	if (p1 < 2 || p2 < 2 || !surface.IsValid()) {
+		return;
+	}
+
+	m_p1 = p1;
+	m_p2 = p2;
+	NurbsCurve<T>::SampleBasis(surface.GetOrderU(), surface.GetNumU(), surface.GetKnotsU(),
+		p1, m_ustarts, m_ubasis);
+	NurbsCurve<T>::SampleBasis(surface.GetOrderW(), surface.GetNumW(), surface.GetKnotsW(),
+		p2, m_wstarts, m_wbasis);
+	m_points.resize(p1 * p2 * 3);
+
+	MarkDirty(0, 0);
+	MarkDirty(surface.GetNumU() - 1, surface.GetNumW() - 1);
+	Update();
+}
+
+template <typename T>
+void IncrementalSurface<T>::SetControlPoint(int i, int j, const T* xyz)
+{
+	m_surface.SetControlPoint(i, j, xyz);
+	MarkDirty(i, j);
+}
+
+template <typename T>
+void IncrementalSurface<T>::SetWeight(int i, int j, T w)
+{
+	if (!m_surface.IsRational() && w != T(1)) {
+		MarkDirty(0, 0);
+		MarkDirty(m_surface.GetNumU() - 1, m_surface.GetNumW() - 1);
+	}
+	m_surface.SetWeight(i, j, w);
+	MarkDirty(i, j);
+}
+
+template <typename T>
+bool IncrementalSurface<T>::Update()
+{
+	m_dirty_begin[0] = m_dirty_begin[1] = 0;
+	m_dirty_end[0] = m_dirty_end[1] = 0;
+	if (m_p1 == 0 || m_ctrl_min[0] > m_ctrl_max[0]) {
+		return false;
+	}
+
+	const int k = m_surface.GetOrderU();
+	const int l = m_surface.GetOrderW();
+	sample_range(m_ustarts, m_ctrl_min[0] - k + 1, m_ctrl_max[0], m_dirty_begin[0], m_dirty_end[0]);
+	sample_range(m_wstarts, m_ctrl_min[1] - l + 1, m_ctrl_max[1], m_dirty_begin[1], m_dirty_end[1]);
+	if (m_dirty_begin[0] >= m_dirty_end[0] || m_dirty_begin[1] >= m_dirty_end[1]) {
+		m_dirty_begin[0] = m_dirty_begin[1] = 0;
+		m_dirty_end[0] = m_dirty_end[1] = 0;
+	} else {
+		EvalSamples(m_dirty_begin[0], m_dirty_end[0], m_dirty_begin[1], m_dirty_end[1]);
+	}
+
+	m_ctrl_min[0] = m_ctrl_min[1] = INT_MAX;
+	m_ctrl_max[0] = m_ctrl_max[1] = INT_MIN;
+	return m_dirty_begin[0] < m_dirty_end[0];
+}
+
+template <typename T>
+void IncrementalSurface<T>::GetDirtyRange(int& u_begin, int& u_end, int& w_begin, int& w_end) const
+{
+	u_begin = m_dirty_begin[0];
+	u_end   = m_dirty_end[0];
+	w_begin = m_dirty_begin[1];
+	w_end   = m_dirty_end[1];
+}
+
+template <typename T>
+void IncrementalSurface<T>::MarkDirty(int i, int j)
+{
+	m_ctrl_min[0] = std::min(m_ctrl_min[0], i);
+	m_ctrl_max[0] = std::max(m_ctrl_max[0], i);
+	m_ctrl_min[1] = std::min(m_ctrl_min[1], j);
+	m_ctrl_max[1] = std::max(m_ctrl_max[1], j);
+}
+
+template <typename T>
+void IncrementalSurface<T>::EvalSamples(int u_begin, int u_end, int w_begin, int w_end)
+{
+	const int k = m_surface.GetOrderU();
+	const int l = m_surface.GetOrderW();
+	for (int iu = u_begin; iu < u_end; ++iu)
+	{
+		for (int iw = w_begin; iw < w_end; ++iw) {
+			m_surface.EvaluateSpan(m_ustarts[iu], &m_ubasis[iu * k], m_wstarts[iw], &m_wbasis[iw * l],
+				&m_points[(iu * m_p2 + iw) * 3]);
+		}
+	}
+}
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "nurbs/Adaptive.h"
+
+#include <vector>
+
+namespace nurbs
+{
+
+// NURBS curve that owns its control points, the optional per-point
+// weights and an arbitrary knot vector. T is float or double.
+template <typename T>
+class NurbsCurve
+{
+public:
+	NurbsCurve();
+	// pts      npts points of (x, y, z)
+	// weights  npts values, null for a non-rational curve
+	// knots    npts + order non-decreasing values, null for the open
+	//          uniform vector of aitn::knot
+	NurbsCurve(int order, int npts, const T* pts, const T* weights = nullptr,
+		const T* knots = nullptr);
+
+	// checked once on construction, the knots can't change after that
+	bool IsValid() const { return m_valid; }
+	bool IsRational() const { return !m_weights.empty(); }
+
+	int GetOrder() const { return m_order; }
+	int GetNum() const { return m_npts; }
+
+	const T* GetControlPoint(int i) const { return &m_pts[i * 3]; }
+	void SetControlPoint(int i, const T* xyz);
+	T GetWeight(int i) const { return IsRational() ? m_weights[i] : T(1); }
+	void SetWeight(int i, T w);
+
+	const std::vector<T>& GetKnots() const { return m_knots; }
+
+	// valid parameter range
+	void GetDomain(T& min, T& max) const;
+
+	// same curve, parameter running the other way over the same domain
+	void Reverse();
+
+	// p is left as is on an invalid curve, like the output of Tessellate
+	void Evaluate(T t, T p[3]) const;
+	// the point from the `order` nonzero basis values of the span whose
+	// first control point is `start`, the inner loop of every evaluator
+	void EvaluateSpan(int start, const T* nbasis, T p[3]) const;
+
+	// ders gets C(t) and its first nders derivatives, 3 values each;
+	// rational curves by the quotient rule on the homogeneous derivatives.
+	// All zero on an invalid curve, nothing written for nders < 0.
+	void Derivatives(T t, int nders, T* ders) const;
+	// the same on the polynomial of knot span `span` (from k - 1 to npts - 1),
+	// at a knot the one-sided derivatives of that span, zeros for any other
+	// span
+	void Derivatives(int span, T t, int nders, T* ders) const;
+
+	// samples points evenly spaced over the domain, out holds samples * 3
+	void Tessellate(int samples, T* out) const;
+
+	// As few points as keep every segment within tol of the curve.
+	// params gets the parameter of each point, points 3 values per point.
+	void TessellateAdaptive(const AdaptiveTolerance& tol, std::vector<T>& params,
+		std::vector<T>& points) const;
+
+	// Interleaved vertices for one vertex buffer: samples records of
+	// (nders + 1) * 3 values, position then C', C'' and so on. Each sample
+	// computes its basis and basis derivatives once.
+	void TessellateDerivs(int samples, int nders, T* out) const;
+
+	// open uniform knot vector of aitn::knot
+	static void OpenKnots(int npts, int order, std::vector<T>& knots);
+
+	// knots non-decreasing with a nonempty domain
+	static bool CheckKnots(int order, int npts, const std::vector<T>& knots);
+
+	// span starts and nonzero basis values of `samples` evenly spaced params
+	static void SampleBasis(int order, int npts, const std::vector<T>& knots,
+		int samples, std::vector<int>& starts, std::vector<T>& basis);
+
+private:
+	// ders from the basis derivatives of one span, aw holds (nders + 1) * 4
+	void DerivsFromBasis(int span, const T* dbasis, int nders, T* ders, T* aw) const;
+
+private:
+	int m_order;
+	int m_npts;
+
+	std::vector<T> m_pts;
+	std::vector<T> m_weights;
+
+	std::vector<T> m_knots;
+
+	bool m_valid;
+
+}; // NurbsCurve
+
+}
+
+#include "nurbs/NurbsCurve.inl"
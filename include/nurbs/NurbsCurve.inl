@@ -0,0 +1,308 @@
+#pragma once
+
+#include "../../external/aitn/bsp_util.h"
+#include "../../external/aitn/rbsp_util.h"
+#include "../../external/aitn/bezier_util.h"
+#include "nurbs/StackBuffer.h"
+
+#include <algorithm>
+
+namespace nurbs
+{
+
+template <typename T>
+NurbsCurve<T>::NurbsCurve()
+	: m_order(0)
+	, m_npts(0)
+	, m_valid(false)
+{
+}
+
+template <typename T>
+NurbsCurve<T>::NurbsCurve(int order, int npts, const T* pts, const T* weights, const T* knots)
+	: m_order(order)
+	, m_npts(npts)
+	, m_valid(false)
+{
+	if (order < 1 || npts < order) {
+		return;
+	}
+
+	m_pts.assign(pts, pts + npts * 3);
+	if (weights) {
+		m_weights.assign(weights, weights + npts);
+	}
+
+	if (knots) {
+		m_knots.assign(knots, knots + npts + order);
+	} else {
+		OpenKnots(npts, order, m_knots);
+	}
+	m_valid = CheckKnots(order, npts, m_knots);
+}
+
+template <typename T>
+bool NurbsCurve<T>::CheckKnots(int order, int npts, const std::vector<T>& knots)
+{
+	for (int i = 1, n = static_cast<int>(knots.size()); i < n; ++i) {
+		if (knots[i] < knots[i - 1]) {
+			return false;
+		}
+	}
+	return knots[order - 1] < knots[npts];
+}
+
+template <typename T>
+void NurbsCurve<T>::SetControlPoint(int i, const T* xyz)
+{
+	T* dst = &m_pts[i * 3];
+	dst[0] = xyz[0];
+	dst[1] = xyz[1];
+	dst[2] = xyz[2];
+}
+
+template <typename T>
+void NurbsCurve<T>::SetWeight(int i, T w)
+{
+	if (m_weights.empty()) {
+		m_weights.resize(m_npts, T(1));
+	}
+	m_weights[i] = w;
+}
+
+template <typename T>
+void NurbsCurve<T>::GetDomain(T& min, T& max) const
+{
+	min = m_knots[m_order - 1];
+	max = m_knots[m_npts];
+}
+
+template <typename T>
+void NurbsCurve<T>::Reverse()
+{
+	for (int i = 0, j = m_npts - 1; i < j; ++i, --j) {
+		std::swap_ranges(&m_pts[i * 3], &m_pts[i * 3] + 3, &m_pts[j * 3]);
+	}
+	std::reverse(m_weights.begin(), m_weights.end());
+
+	const T sum = m_knots[m_order - 1] + m_knots[m_npts];
+	std::reverse(m_knots.begin(), m_knots.end());
+	for (auto& k : m_knots) {
+		k = sum - k;
+	}
+}
+
+template <typename T>
+void NurbsCurve<T>::Evaluate(T t, T p[3]) const
+{
+	if (!IsValid()) {
+		return;
+	}
+
+	const int k = m_order;
+
+	// basis values plus left/right
+	StackBuffer<T, 3 * MAX_STACK_ORDER> buffer(3 * k);
+	T* nbasis = buffer.Data();
+	T* left  = nbasis + k;
+	T* right = left + k;
+
+	const int span = aitn::find_span(k, t, m_npts, m_knots);
+	aitn::basis_span(k, t, span, m_knots, nbasis, left, right);
+	EvaluateSpan(span - k + 1, nbasis, p);
+}
+
+template <typename T>
+void NurbsCurve<T>::EvaluateSpan(int start, const T* nbasis, T p[3]) const
+{
+	const bool rational = IsRational();
+	T v[3] = { 0, 0, 0 }, h = 0;
+	for (int i = 0; i < m_order; ++i)
+	{
+		T b = nbasis[i];
+		if (rational) {
+			b *= m_weights[start + i];
+		}
+		const T* src = &m_pts[(start + i) * 3];
+		v[0] += b * src[0];
+		v[1] += b * src[1];
+		v[2] += b * src[2];
+		h += b;
+	}
+
+	if (rational) {
+		aitn::project_homogeneous(v, h, 3, p);
+	} else {
+		std::copy(v, v + 3, p);
+	}
+}
+
+template <typename T>
+void NurbsCurve<T>::Derivatives(T t, int nders, T* ders) const
+{
+	if (nders < 0) {
+		return;
+	}
+	if (!IsValid()) {
+		std::fill(ders, ders + (nders + 1) * 3, T(0));
+		return;
+	}
+
+	Derivatives(aitn::find_span(m_order, t, m_npts, m_knots), t, nders, ders);
+}
+
+template <typename T>
+void NurbsCurve<T>::Derivatives(int span, T t, int nders, T* ders) const
+{
+	const int k = m_order;
+	if (nders < 0) {
+		return;
+	}
+	if (!IsValid() || span < k - 1 || span >= m_npts) {
+		std::fill(ders, ders + (nders + 1) * 3, T(0));
+		return;
+	}
+
+	// closest point queries call this in their inner loop
+	StackBuffer<T, MAX_STACK_DERIVS> buffer((nders + 1) * k + aitn::dbasis_work_size(k) + (nders + 1) * 4);
+	T* dbasis = buffer.Data();
+	T* aw = dbasis + (nders + 1) * k + aitn::dbasis_work_size(k);
+
+	aitn::dbasis_span(k, t, span, m_knots, nders, dbasis, dbasis + (nders + 1) * k);
+	DerivsFromBasis(span, dbasis, nders, ders, aw);
+}
+
+template <typename T>
+void NurbsCurve<T>::Tessellate(int samples, T* out) const
+{
+	if (samples < 2 || !IsValid()) {
+		return;
+	}
+
+	T t0, t1;
+	GetDomain(t0, t1);
+	for (int i = 0; i < samples; ++i) {
+		T t = i == samples - 1 ? t1 : t0 + (t1 - t0) * i / (samples - 1);
+		Evaluate(t, out + i * 3);
+	}
+}
+
+template <typename T>
+void NurbsCurve<T>::TessellateAdaptive(const AdaptiveTolerance& tol, std::vector<T>& params,
+	                                   std::vector<T>& points) const
+{
+	params.clear();
+	points.clear();
+	if (!IsValid()) {
+		return;
+	}
+
+	std::vector<T> seeds;
+	adaptive_seeds(m_order, m_npts, m_knots, seeds);
+	adaptive_params(seeds, 1, [this](T t, T* p) { Evaluate(t, p); }, tol, params, &points);
+}
+
+template <typename T>
+void NurbsCurve<T>::TessellateDerivs(int samples, int nders, T* out) const
+{
+	if (samples < 2 || nders < 0 || !IsValid()) {
+		return;
+	}
+
+	const int k = m_order;
+
+	StackBuffer<T, MAX_STACK_DERIVS> buffer((nders + 1) * k + aitn::dbasis_work_size(k) + (nders + 1) * 4);
+	T* dbasis = buffer.Data();
+	T* aw = dbasis + (nders + 1) * k + aitn::dbasis_work_size(k);
+
+	T t0, t1;
+	GetDomain(t0, t1);
+	for (int i = 0; i < samples; ++i)
+	{
+		T t = i == samples - 1 ? t1 : t0 + (t1 - t0) * i / (samples - 1);
+		const int span = aitn::find_span(k, t, m_npts, m_knots);
+		aitn::dbasis_span(k, t, span, m_knots, nders, dbasis, dbasis + (nders + 1) * k);
+		DerivsFromBasis(span, dbasis, nders, out, aw);
+		out += (nders + 1) * 3;
+	}
+}
+
+template <typename T>
+void NurbsCurve<T>::DerivsFromBasis(int span, const T* dbasis, int nders, T* ders, T* aw) const
+{
+	const int k = m_order;
+	const int start = span - k + 1;
+	const bool rational = IsRational();
+
+	// derivatives of (hx, hy, hz, h)
+	for (int d = 0; d <= nders; ++d)
+	{
+		const T* nbasis = dbasis + d * k;
+		T* a = aw + d * 4;
+		a[0] = a[1] = a[2] = a[3] = 0;
+		for (int i = 0; i < k; ++i)
+		{
+			T b = nbasis[i];
+			if (rational) {
+				b *= m_weights[start + i];
+			}
+			const T* src = &m_pts[(start + i) * 3];
+			a[0] += b * src[0];
+			a[1] += b * src[1];
+			a[2] += b * src[2];
+			a[3] += b;
+		}
+	}
+
+	if (!rational)
+	{
+		for (int d = 0; d <= nders; ++d) {
+			for (int c = 0; c < 3; ++c) {
+				ders[d * 3 + c] = aw[d * 4 + c];
+			}
+		}
+		return;
+	}
+
+	// C(d) = (A(d) - sum_i binomial(d, i) h(i) C(d - i)) / h, NURBS Book A4.2
+	for (int d = 0; d <= nders; ++d)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			T v = aw[d * 4 + c];
+			for (int i = 1; i <= d; ++i) {
+				v -= aitn::binomial<T>(d, i) * aw[i * 4 + 3] * ders[(d - i) * 3 + c];
+			}
+			ders[d * 3 + c] = aw[3] != 0 ? v / aw[3] : 0;
+		}
+	}
+}
+
+template <typename T>
+void NurbsCurve<T>::OpenKnots(int npts, int order, std::vector<T>& knots)
+{
+	std::vector<int> x(aitn::bsp_knot_size(npts, order));
+	aitn::knot(npts, order, x.data());
+	knots.assign(x.begin(), x.end());
+}
+
+template <typename T>
+void NurbsCurve<T>::SampleBasis(int order, int npts, const std::vector<T>& knots,
+	                            int samples, std::vector<int>& starts, std::vector<T>& basis)
+{
+	std::vector<T> left(order), right(order);
+	starts.resize(samples);
+	basis.resize(samples * order);
+
+	const T t0 = knots[order - 1];
+	const T t1 = knots[npts];
+	for (int i = 0; i < samples; ++i)
+	{
+		T t = i == samples - 1 ? t1 : t0 + (t1 - t0) * i / (samples - 1);
+		int span = aitn::find_span(order, t, npts, knots);
+		starts[i] = span - order + 1;
+		aitn::basis_span(order, t, span, knots, &basis[i * order], left.data(), right.data());
+	}
+}
+
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "nurbs/NurbsCurve.h"
+#include "nurbs/Adaptive.h"
+
+#include <vector>
+
+namespace nurbs
+{
+
+// Vertex attributes for NurbsSurface::TessellateVertices, 3 values each,
+// written interleaved in this order
+enum SurfaceVertex
+{
+	SURF_POSITION = 1 << 0,
+	SURF_NORMAL   = 1 << 1,	// unit Su x Sw, zero where that vanishes
+	SURF_DU       = 1 << 2,
+	SURF_DW       = 1 << 3,
+	SURF_DUU      = 1 << 4,
+	SURF_DUW      = 1 << 5,
+	SURF_DWW      = 1 << 6,
+};
+
+// Tensor-product NURBS surface that owns its control net, the optional
+// per-point weights and arbitrary (non-uniform, clamped or not) knot
+// vectors in u and w. T is float or double.
+template <typename T>
+class NurbsSurface
+{
+public:
+	NurbsSurface();
+	// net      npts x mpts points of (x, y, z), w varying fastest
+	// weights  npts x mpts values, null for a non-rational surface
+	// knots_u  npts + order_u non-decreasing values, null for the open
+	//          uniform vector of aitn::knot; the same for knots_w
+	NurbsSurface(int order_u, int order_w, int npts, int mpts, const T* net,
+		const T* weights = nullptr, const T* knots_u = nullptr, const T* knots_w = nullptr);
+
+	// checked once on construction, the knots can't change after that
+	bool IsValid() const { return m_valid; }
+	bool IsRational() const { return !m_weights.empty(); }
+
+	int GetOrderU() const { return m_order_u; }
+	int GetOrderW() const { return m_order_w; }
+	int GetNumU() const { return m_npts; }
+	int GetNumW() const { return m_mpts; }
+
+	const T* GetControlPoint(int i, int j) const { return &m_net[(i * m_mpts + j) * 3]; }
+	void SetControlPoint(int i, int j, const T* xyz);
+	T GetWeight(int i, int j) const { return IsRational() ? m_weights[i * m_mpts + j] : T(1); }
+	void SetWeight(int i, int j, T w);
+
+	const std::vector<T>& GetKnotsU() const { return m_knots_u; }
+	const std::vector<T>& GetKnotsW() const { return m_knots_w; }
+
+	// valid parameter range
+	void GetDomainU(T& min, T& max) const;
+	void GetDomainW(T& min, T& max) const;
+
+	// p is left as is on an invalid surface, like the output of Tessellate
+	void Evaluate(T u, T w, T p[3]) const;
+	// the same from the nonzero u and w basis values of the span pair whose
+	// first control point is (ustart, wstart)
+	void EvaluateSpan(int ustart, const T* nbasis, int wstart, const T* mbasis, T p[3]) const;
+
+	// skl gets the partials d^(a+b) S / du^a dw^b for a + b <= nders, 3
+	// values each at skl[(a * (nders + 1) + b) * 3]; all zero on an invalid
+	// surface, nothing written for nders < 0
+	void Derivatives(T u, T w, int nders, T* skl) const;
+	// on the patch of one span pair, see NurbsCurve::Derivatives
+	void Derivatives(int uspan, int wspan, T u, T w, int nders, T* skl) const;
+	// unit normal Su x Sw, zero where it vanishes or the surface is invalid
+	void Normal(T u, T w, T n[3]) const;
+
+	// p1 x p2 points evenly spaced over the domain, out holds p1 * p2 * 3
+	void Tessellate(int p1, int p2, T* out) const;
+
+	// p1 x p2 vertices of the SurfaceVertex attributes in format, ready for
+	// one interleaved vertex buffer. The basis derivatives are computed once
+	// per u row and once per w column, positions and derivatives come from
+	// a single pass over each k x l block.
+	void TessellateVertices(int p1, int p2, int format, T* out) const;
+	// values per vertex
+	static int GetVertexSize(int format);
+
+	// Isoparametric curve at a fixed u (running in w) or fixed w, an empty
+	// invalid curve from an invalid surface
+	void IsoCurveU(T u, NurbsCurve<T>& curve) const;
+	void IsoCurveW(T w, NurbsCurve<T>& curve) const;
+
+	// Triangle mesh within tol of the surface. Each polynomial patch (knot
+	// span pair) gets its own grid, refined against that patch's isocurves
+	// and cell diagonals, zipped to edges shared with its neighbours; the
+	// surface borders are the adaptive tessellations of the boundary curves
+	// alone. A patch
+	// sharing a border (same control points, weights and knots, in either
+	// direction) gets the same border vertices, so the meshes do not crack.
+	void TessellateAdaptive(const AdaptiveTolerance& tol, AdaptiveMesh<T>& mesh) const;
+
+private:
+	// skl from the basis derivatives of one span pair, aw holds
+	// (nders + 1)^2 * 4 values
+	void DerivsFromBasis(int uspan, const T* ubasis, int wspan, const T* wbasis,
+		int nders, T* skl, T* aw) const;
+
+	static void WriteVertex(int format, int nders, const T* skl, T* out);
+
+	static bool IsClamped(int order, int npts, const std::vector<T>& knots);
+
+private:
+	int m_order_u, m_order_w;
+	int m_npts, m_mpts;
+
+	std::vector<T> m_net;
+	std::vector<T> m_weights;
+
+	std::vector<T> m_knots_u, m_knots_w;
+
+	bool m_valid;
+
+}; // NurbsSurface
+
+}
+
+#include "nurbs/NurbsSurface.inl"
@@ -0,0 +1,859 @@
+#pragma once
+
+#include "../../external/aitn/bsp_util.h"
+#include "../../external/aitn/rbsp_util.h"
+#include "../../external/aitn/bezier_util.h"
+#include "nurbs/StackBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nurbs
+{
+
+template <typename T>
+NurbsSurface<T>::NurbsSurface()
+	: m_order_u(0)
+	, m_order_w(0)
+	, m_npts(0)
+	, m_mpts(0)
+	, m_valid(false)
+{
+}
+
+template <typename T>
+NurbsSurface<T>::NurbsSurface(int order_u, int order_w, int npts, int mpts, const T* net,
+	                          const T* weights, const T* knots_u, const T* knots_w)
+	: m_order_u(order_u)
+	, m_order_w(order_w)
+	, m_npts(npts)
+	, m_mpts(mpts)
+	, m_valid(false)
+{
+	if (order_u < 1 || order_w < 1 || npts < order_u || mpts < order_w) {
+		return;
+	}
+
+	m_net.assign(net, net + npts * mpts * 3);
+	if (weights) {
+		m_weights.assign(weights, weights + npts * mpts);
+	}
+
+	if (knots_u) {
+		m_knots_u.assign(knots_u, knots_u + npts + order_u);
+	} else {
+		NurbsCurve<T>::OpenKnots(npts, order_u, m_knots_u);
+	}
+	if (knots_w) {
+		m_knots_w.assign(knots_w, knots_w + mpts + order_w);
+	} else {
+		NurbsCurve<T>::OpenKnots(mpts, order_w, m_knots_w);
+	}
+	m_valid = NurbsCurve<T>::CheckKnots(order_u, npts, m_knots_u)
+		&& NurbsCurve<T>::CheckKnots(order_w, mpts, m_knots_w);
+}
+
+template <typename T>
+void NurbsSurface<T>::SetControlPoint(int i, int j, const T* xyz)
+{
+	T* dst = &m_net[(i * m_mpts + j) * 3];
+	dst[0] = xyz[0];
+	dst[1] = xyz[1];
+	dst[2] = xyz[2];
+}
+
+template <typename T>
+void NurbsSurface<T>::SetWeight(int i, int j, T w)
+{
+	if (m_weights.empty()) {
+		m_weights.resize(m_npts * m_mpts, T(1));
+	}
+	m_weights[i * m_mpts + j] = w;
+}
+
+template <typename T>
+void NurbsSurface<T>::GetDomainU(T& min, T& max) const
+{
+	min = m_knots_u[m_order_u - 1];
+	max = m_knots_u[m_npts];
+}
+
+template <typename T>
+void NurbsSurface<T>::GetDomainW(T& min, T& max) const
+{
+	min = m_knots_w[m_order_w - 1];
+	max = m_knots_w[m_mpts];
+}
+
+template <typename T>
+void NurbsSurface<T>::Evaluate(T u, T w, T p[3]) const
+{
+	if (!IsValid()) {
+		return;
+	}
+
+	const int k = m_order_u;
+	const int l = m_order_w;
+
+	// basis values plus left/right
+	const int n = k > l ? k : l;
+	StackBuffer<T, 4 * MAX_STACK_ORDER> buffer(4 * n);
+	T* nbasis = buffer.Data();
+	T* mbasis = nbasis + n;
+	T* left   = mbasis + n;
+	T* right  = left + n;
+
+	const int uspan = aitn::find_span(k, u, m_npts, m_knots_u);
+	const int wspan = aitn::find_span(l, w, m_mpts, m_knots_w);
+	aitn::basis_span(k, u, uspan, m_knots_u, nbasis, left, right);
+	aitn::basis_span(l, w, wspan, m_knots_w, mbasis, left, right);
+	EvaluateSpan(uspan - k + 1, nbasis, wspan - l + 1, mbasis, p);
+}
+
+template <typename T>
+void NurbsSurface<T>::EvaluateSpan(int ustart, const T* nbasis, int wstart, const T* mbasis, T p[3]) const
+{
+	const bool rational = IsRational();
+	T v[3] = { 0, 0, 0 }, h = 0;
+	for (int i = 0; i < m_order_u; ++i)
+	{
+		const int row = (ustart + i) * m_mpts + wstart;
+		for (int j = 0; j < m_order_w; ++j)
+		{
+			T b = nbasis[i] * mbasis[j];
+			if (rational) {
+				b *= m_weights[row + j];
+			}
+			const T* src = &m_net[(row + j) * 3];
+			v[0] += b * src[0];
+			v[1] += b * src[1];
+			v[2] += b * src[2];
+			h += b;
+		}
+	}
+
+	if (rational) {
+		aitn::project_homogeneous(v, h, 3, p);
+	} else {
+		std::copy(v, v + 3, p);
+	}
+}
+
+template <typename T>
+void NurbsSurface<T>::Derivatives(T u, T w, int nders, T* skl) const
+{
+	if (nders < 0) {
+		return;
+	}
+	if (!IsValid()) {
+		std::fill(skl, skl + (nders + 1) * (nders + 1) * 3, T(0));
+		return;
+	}
+
+	Derivatives(aitn::find_span(m_order_u, u, m_npts, m_knots_u),
+		aitn::find_span(m_order_w, w, m_mpts, m_knots_w), u, w, nders, skl);
+}
+
+template <typename T>
+void NurbsSurface<T>::Derivatives(int uspan, int wspan, T u, T w, int nders, T* skl) const
+{
+	const int k = m_order_u;
+	const int l = m_order_w;
+	const int d1 = nders + 1;
+	if (nders < 0) {
+		return;
+	}
+	if (!IsValid() || uspan < k - 1 || uspan >= m_npts || wspan < l - 1 || wspan >= m_mpts) {
+		std::fill(skl, skl + d1 * d1 * 3, T(0));
+		return;
+	}
+
+	StackBuffer<T, MAX_STACK_DERIVS> buffer(d1 * (k + l) + aitn::dbasis_work_size(k > l ? k : l) + d1 * d1 * 4);
+	T* ubasis = buffer.Data();
+	T* wbasis = ubasis + d1 * k;
+	T* aw = wbasis + d1 * l;
+	T* scratch = aw + d1 * d1 * 4;
+
+	aitn::dbasis_span(k, u, uspan, m_knots_u, nders, ubasis, scratch);
+	aitn::dbasis_span(l, w, wspan, m_knots_w, nders, wbasis, scratch);
+	DerivsFromBasis(uspan, ubasis, wspan, wbasis, nders, skl, aw);
+}
+
+template <typename T>
+void NurbsSurface<T>::Normal(T u, T w, T n[3]) const
+{
+	if (!IsValid()) {
+		n[0] = n[1] = n[2] = 0;
+		return;
+	}
+
+	T skl[4 * 3];
+	Derivatives(u, w, 1, skl);
+	WriteVertex(SURF_NORMAL, 1, skl, n);
+}
+
+template <typename T>
+void NurbsSurface<T>::Tessellate(int p1, int p2, T* out) const
+{
+	if (p1 < 2 || p2 < 2 || !IsValid()) {
+		return;
+	}
+
+	const int k = m_order_u;
+	const int l = m_order_w;
+
+	std::vector<int> ustarts, wstarts;
+	std::vector<T> ubasis, wbasis;
+	NurbsCurve<T>::SampleBasis(k, m_npts, m_knots_u, p1, ustarts, ubasis);
+	NurbsCurve<T>::SampleBasis(l, m_mpts, m_knots_w, p2, wstarts, wbasis);
+
+	for (int iu = 0; iu < p1; ++iu)
+	{
+		for (int iw = 0; iw < p2; ++iw)
+		{
+			EvaluateSpan(ustarts[iu], &ubasis[iu * k], wstarts[iw], &wbasis[iw * l], out);
+			out += 3;
+		}
+	}
+}
+
+template <typename T>
+void NurbsSurface<T>::TessellateVertices(int p1, int p2, int format, T* out) const
+{
+	if (p1 < 2 || p2 < 2 || !IsValid()) {
+		return;
+	}
+
+	int nders = 0;
+	if (format & (SURF_DUU | SURF_DUW | SURF_DWW)) {
+		nders = 2;
+	} else if (format & (SURF_NORMAL | SURF_DU | SURF_DW)) {
+		nders = 1;
+	}
+
+	const int k = m_order_u;
+	const int l = m_order_w;
+	const int d1 = nders + 1;
+	const int size = GetVertexSize(format);
+
+	T u0, u1, w0, w1;
+	GetDomainU(u0, u1);
+	GetDomainW(w0, w1);
+
+	std::vector<T> scratch(aitn::dbasis_work_size(k > l ? k : l));
+
+	// w basis derivatives of every column, shared by all rows
+	std::vector<int> wspans(p2);
+	std::vector<T> wbasis(p2 * d1 * l);
+	for (int iw = 0; iw < p2; ++iw)
+	{
+		T w = iw == p2 - 1 ? w1 : w0 + (w1 - w0) * iw / (p2 - 1);
+		wspans[iw] = aitn::find_span(l, w, m_mpts, m_knots_w);
+		aitn::dbasis_span(l, w, wspans[iw], m_knots_w, nders, &wbasis[iw * d1 * l], scratch.data());
+	}
+
+	std::vector<T> ubasis(d1 * k), skl(d1 * d1 * 3), aw(d1 * d1 * 4);
+	for (int iu = 0; iu < p1; ++iu)
+	{
+		T u = iu == p1 - 1 ? u1 : u0 + (u1 - u0) * iu / (p1 - 1);
+		const int uspan = aitn::find_span(k, u, m_npts, m_knots_u);
+		aitn::dbasis_span(k, u, uspan, m_knots_u, nders, ubasis.data(), scratch.data());
+		for (int iw = 0; iw < p2; ++iw)
+		{
+			DerivsFromBasis(uspan, ubasis.data(), wspans[iw], &wbasis[iw * d1 * l],
+				nders, skl.data(), aw.data());
+			WriteVertex(format, nders, skl.data(), out);
+			out += size;
+		}
+	}
+}
+
+template <typename T>
+int NurbsSurface<T>::GetVertexSize(int format)
+{
+	int size = 0;
+	for (int bit = SURF_POSITION; bit <= SURF_DWW; bit <<= 1) {
+		if (format & bit) {
+			size += 3;
+		}
+	}
+	return size;
+}
+
+template <typename T>
+void NurbsSurface<T>::IsoCurveU(T u, NurbsCurve<T>& curve) const
+{
+	if (!IsValid()) {
+		curve = NurbsCurve<T>();
+		return;
+	}
+
+	const int k = m_order_u;
+	std::vector<T> nbasis(k), left(k), right(k);
+	const int span = aitn::find_span(k, u, m_npts, m_knots_u);
+	aitn::basis_span(k, u, span, m_knots_u, nbasis.data(), left.data(), right.data());
+
+	// blend the k rows in homogeneous space
+	const bool rational = IsRational();
+	std::vector<T> pts(m_mpts * 3, T(0)), weights(rational ? m_mpts : 0, T(0));
+	for (int i = 0; i < k; ++i)
+	{
+		const int row = (span - k + 1 + i) * m_mpts;
+		for (int j = 0; j < m_mpts; ++j)
+		{
+			T b = nbasis[i];
+			if (rational) {
+				b *= m_weights[row + j];
+				weights[j] += b;
+			}
+			const T* src = &m_net[(row + j) * 3];
+			for (int c = 0; c < 3; ++c) {
+				pts[j * 3 + c] += b * src[c];
+			}
+		}
+	}
+	for (int j = 0; j < m_mpts && rational; ++j) {
+		aitn::project_homogeneous(&pts[j * 3], weights[j], 3, &pts[j * 3]);
+	}
+
+	curve = NurbsCurve<T>(m_order_w, m_mpts, pts.data(),
+		rational ? weights.data() : nullptr, m_knots_w.data());
+}
+
+template <typename T>
+void NurbsSurface<T>::IsoCurveW(T w, NurbsCurve<T>& curve) const
+{
+	if (!IsValid()) {
+		curve = NurbsCurve<T>();
+		return;
+	}
+
+	const int l = m_order_w;
+	std::vector<T> mbasis(l), left(l), right(l);
+	const int span = aitn::find_span(l, w, m_mpts, m_knots_w);
+	aitn::basis_span(l, w, span, m_knots_w, mbasis.data(), left.data(), right.data());
+
+	const bool rational = IsRational();
+	std::vector<T> pts(m_npts * 3, T(0)), weights(rational ? m_npts : 0, T(0));
+	for (int i = 0; i < m_npts; ++i)
+	{
+		const int row = i * m_mpts + span - l + 1;
+		for (int j = 0; j < l; ++j)
+		{
+			T b = mbasis[j];
+			if (rational) {
+				b *= m_weights[row + j];
+				weights[i] += b;
+			}
+			const T* src = &m_net[(row + j) * 3];
+			for (int c = 0; c < 3; ++c) {
+				pts[i * 3 + c] += b * src[c];
+			}
+		}
+	}
+	for (int i = 0; i < m_npts && rational; ++i) {
+		aitn::project_homogeneous(&pts[i * 3], weights[i], 3, &pts[i * 3]);
+	}
+
+	curve = NurbsCurve<T>(m_order_u, m_npts, pts.data(),
+		rational ? weights.data() : nullptr, m_knots_u.data());
+}
+
+template <typename T>
+void NurbsSurface<T>::TessellateAdaptive(const AdaptiveTolerance& tol, AdaptiveMesh<T>& mesh) const
+{
+	mesh.Clear();
+	if (!IsValid()) {
+		return;
+	}
+
+	T u0, u1, w0, w1;
+	GetDomainU(u0, u1);
+	GetDomainW(w0, w1);
+
+	auto add_vertex = [&](T u, T w, const T* p) -> int {
+		mesh.points.insert(mesh.points.end(), p, p + 3);
+		mesh.params.push_back(u);
+		mesh.params.push_back(w);
+		return mesh.GetVertexNum() - 1;
+	};
+	auto add_triangle = [&](int a, int b, int c) {
+		const T* pa = &mesh.params[a * 2];
+		const T* pb = &mesh.params[b * 2];
+		const T* pc = &mesh.params[c * 2];
+		const T area = (pb[0] - pa[0]) * (pc[1] - pa[1]) - (pb[1] - pa[1]) * (pc[0] - pa[0]);
+		if (area < 0) {
+			std::swap(b, c);
+		}
+		mesh.triangles.push_back(a);
+		mesh.triangles.push_back(b);
+		mesh.triangles.push_back(c);
+	};
+
+	// patch s in u covers useeds[s * pu] to useeds[(s + 1) * pu], the same
+	// in w
+	std::vector<T> useeds, wseeds;
+	adaptive_seeds(m_order_u, m_npts, m_knots_u, useeds);
+	adaptive_seeds(m_order_w, m_mpts, m_knots_w, wseeds);
+	const int pu = adaptive_pieces(m_order_u);
+	const int pw = adaptive_pieces(m_order_w);
+	const int nsu = static_cast<int>(useeds.size() - 1) / pu;
+	const int nsw = static_cast<int>(wseeds.size() - 1) / pw;
+
+	// patch corners, (nsu + 1) x (nsw + 1); the outer ones come from the
+	// borders, the surface corners are the control points themselves when
+	// the knots are clamped
+	std::vector<int> corners((nsu + 1) * (nsw + 1));
+	auto corner = [&](int i, int j) -> int& { return corners[i * (nsw + 1) + j]; };
+	const bool clamped = IsClamped(m_order_u, m_npts, m_knots_u)
+		&& IsClamped(m_order_w, m_mpts, m_knots_w);
+	for (int i = 0; i < 2; ++i)
+	{
+		for (int j = 0; j < 2; ++j)
+		{
+			const T u = i ? u1 : u0;
+			const T w = j ? w1 : w0;
+			T p[3];
+			if (clamped) {
+				const T* src = GetControlPoint(i ? m_npts - 1 : 0, j ? m_mpts - 1 : 0);
+				p[0] = src[0];
+				p[1] = src[1];
+				p[2] = src[2];
+			} else {
+				Evaluate(u, w, p);
+			}
+			corner(i ? nsu : 0, j ? nsw : 0) = add_vertex(u, w, p);
+		}
+	}
+
+	// Patch edges, end corners included: edges_w[iu * nsw + sw] runs in w
+	// at u = useeds[iu * pu] over patch sw, edges_u[iw * nsu + su] in u.
+	// Each is shared by the two patches on either side.
+	struct Edge
+	{
+		std::vector<int> verts;
+		std::vector<T> params;
+	};
+	std::vector<Edge> edges_w((nsu + 1) * nsw), edges_u((nsw + 1) * nsu);
+
+	// borders: u0, u1 run in w, w0, w1 run in u
+	NurbsCurve<T> curve;
+	std::vector<T> params, points, cseeds;
+	std::vector<int> border, bounds;
+	std::vector<T> border_t;
+	for (int side = 0; side < 4; ++side)
+	{
+		const bool run_w = side < 2;
+		const bool at_end = side % 2 == 1;
+		if (run_w) {
+			IsoCurveU(at_end ? u1 : u0, curve);
+		} else {
+			IsoCurveW(at_end ? w1 : w0, curve);
+		}
+
+		// tessellate in a direction that depends on the curve only
+		bool reversed = false;
+		for (int i = 0, j = curve.GetNum() - 1; i < j; ++i, --j)
+		{
+			const T* a = curve.GetControlPoint(i);
+			const T* b = curve.GetControlPoint(j);
+			if (!std::equal(a, a + 3, b)) {
+				reversed = std::lexicographical_compare(b, b + 3, a, a + 3);
+				break;
+			}
+		}
+		if (reversed) {
+			curve.Reverse();
+		}
+		curve.TessellateAdaptive(tol, params, points);
+
+		const T t0 = run_w ? w0 : u0;
+		const T t1 = run_w ? w1 : u1;
+		const int n = static_cast<int>(params.size());
+		const int ns = run_w ? nsw : nsu;
+		const int pieces = run_w ? pw : pu;
+		const int c0 = run_w ? corner(at_end ? nsu : 0, 0) : corner(0, at_end ? nsw : 0);
+		const int c1 = run_w ? corner(at_end ? nsu : 0, nsw) : corner(nsu, at_end ? nsw : 0);
+		border.clear();
+		border_t.clear();
+		border.push_back(c0);
+		border_t.push_back(t0);
+		for (int i = 1; i + 1 < n; ++i)
+		{
+			const int src = reversed ? n - 1 - i : i;
+			const T t = reversed ? t0 + t1 - params[src] : params[src];
+			const T u = run_w ? (at_end ? u1 : u0) : t;
+			const T w = run_w ? t : (at_end ? w1 : w0);
+			border.push_back(add_vertex(u, w, &points[src * 3]));
+			border_t.push_back(t);
+		}
+		border.push_back(c1);
+		border_t.push_back(t1);
+
+		// the curve's seeds are emitted as they are, so its patch ends are
+		// found exactly; seed s of one direction is ns * pieces - s of the
+		// other
+		adaptive_seeds(curve.GetOrder(), curve.GetNum(), curve.GetKnots(), cseeds);
+		bounds.assign(ns + 1, 0);
+		for (int i = 0, s = 0; i < n && s < static_cast<int>(cseeds.size()); ++i)
+		{
+			if (params[i] != cseeds[s]) {
+				continue;
+			}
+			if (s % pieces == 0) {
+				const int b = s / pieces;
+				bounds[reversed ? ns - b : b] = reversed ? n - 1 - i : i;
+			}
+			++s;
+		}
+
+		for (int s = 0; s <= ns; ++s)
+		{
+			if (run_w) {
+				corner(at_end ? nsu : 0, s) = border[bounds[s]];
+			} else {
+				corner(s, at_end ? nsw : 0) = border[bounds[s]];
+			}
+		}
+		for (int s = 0; s < ns; ++s)
+		{
+			Edge& edge = run_w ? edges_w[(at_end ? nsu : 0) * nsw + s]
+				: edges_u[(at_end ? nsw : 0) * nsu + s];
+			edge.verts.assign(border.begin() + bounds[s], border.begin() + bounds[s + 1] + 1);
+			edge.params.assign(border_t.begin() + bounds[s], border_t.begin() + bounds[s + 1] + 1);
+		}
+	}
+
+	// Each patch gets a grid whose u and w params are refined against that
+	// patch's own isocurves and cell diagonals; grid_u[su * nsw + sw] and
+	// grid_w hold them, patch ends included.
+	std::vector<std::vector<T>> grid_u(nsu * nsw), grid_w(nsu * nsw);
+	std::vector<T> su_seeds, sw_seeds, cell;
+	std::vector<char> split_u, split_w;
+	for (int su = 0; su < nsu; ++su)
+	{
+		su_seeds.assign(useeds.begin() + su * pu, useeds.begin() + (su + 1) * pu + 1);
+		for (int sw = 0; sw < nsw; ++sw)
+		{
+			sw_seeds.assign(wseeds.begin() + sw * pw, wseeds.begin() + (sw + 1) * pw + 1);
+			std::vector<T>& us = grid_u[su * nsw + sw];
+			std::vector<T>& ws = grid_w[su * nsw + sw];
+			// u params against the seed w lines, then w params against every
+			// u line that gives
+			adaptive_params(su_seeds, static_cast<int>(sw_seeds.size()), [&](T u, T* p) {
+				for (size_t j = 0; j < sw_seeds.size(); ++j) {
+					Evaluate(u, sw_seeds[j], p + j * 3);
+				}
+			}, tol, us);
+			adaptive_params(sw_seeds, static_cast<int>(us.size()), [&](T w, T* p) {
+				for (size_t i = 0; i < us.size(); ++i) {
+					Evaluate(us[i], w, p + i * 3);
+				}
+			}, tol, ws);
+
+			// the isolines miss twist; halve the cells whose triangle
+			// diagonal strays from the surface at the cell centre
+			const size_t cu = us.size(), cw = ws.size();
+			cell.resize(cu * cw * 3);
+			for (size_t i = 0; i < cu; ++i) {
+				for (size_t j = 0; j < cw; ++j) {
+					Evaluate(us[i], ws[j], &cell[(i * cw + j) * 3]);
+				}
+			}
+			split_u.assign(cu, 0);
+			split_w.assign(cw, 0);
+			for (size_t i = 0; i + 1 < cu; ++i)
+			{
+				for (size_t j = 0; j + 1 < cw; ++j)
+				{
+					T mid[3];
+					Evaluate((us[i] + us[i + 1]) / 2, (ws[j] + ws[j + 1]) / 2, mid);
+					if (!adaptive_flat(&cell[(i * cw + j) * 3], mid, &cell[((i + 1) * cw + j + 1) * 3], tol.chord, 1.0)) {
+						split_u[i] = split_w[j] = 1;
+					}
+				}
+			}
+			for (size_t i = cu - 1; i-- > 0; ) {
+				if (split_u[i]) {
+					us.insert(us.begin() + i + 1, (us[i] + us[i + 1]) / 2);
+				}
+			}
+			for (size_t j = cw - 1; j-- > 0; ) {
+				if (split_w[j]) {
+					ws.insert(ws.begin() + j + 1, (ws[j] + ws[j + 1]) / 2);
+				}
+			}
+		}
+	}
+
+	// Inner patch corners and edges, from the surface itself. An edge takes
+	// the grid params of both patches beside it as well as its own, so
+	// neither zips a fine grid row to a long edge segment.
+	for (int i = 1; i < nsu; ++i)
+	{
+		for (int j = 1; j < nsw; ++j)
+		{
+			const T u = useeds[i * pu];
+			const T w = wseeds[j * pw];
+			T p[3];
+			Evaluate(u, w, p);
+			corner(i, j) = add_vertex(u, w, p);
+		}
+	}
+	std::vector<T> seeds, merged;
+	for (int dir = 0; dir < 2; ++dir)
+	{
+		const bool run_w = dir == 0;
+		const int nfixed = run_w ? nsu : nsw;
+		const int ns = run_w ? nsw : nsu;
+		const int pieces = run_w ? pw : pu;
+		const std::vector<T>& fixed = run_w ? useeds : wseeds;
+		const std::vector<T>& running = run_w ? wseeds : useeds;
+		for (int f = 1; f < nfixed; ++f)
+		{
+			const T c = fixed[f * (run_w ? pu : pw)];
+			for (int s = 0; s < ns; ++s)
+			{
+				seeds.assign(running.begin() + s * pieces, running.begin() + (s + 1) * pieces + 1);
+				adaptive_params(seeds, 1, [&](T t, T* p) {
+					if (run_w) {
+						Evaluate(c, t, p);
+					} else {
+						Evaluate(t, c, p);
+					}
+				}, tol, params);
+				for (int side = -1; side <= 0; ++side)
+				{
+					const int patch = run_w ? (f + side) * nsw + s : s * nsw + f + side;
+					const std::vector<T>& grid = run_w ? grid_w[patch] : grid_u[patch];
+					merged.clear();
+					std::merge(params.begin(), params.end(), grid.begin(), grid.end(), std::back_inserter(merged));
+					merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+					params.swap(merged);
+				}
+
+				Edge& edge = run_w ? edges_w[f * nsw + s] : edges_u[f * nsu + s];
+				const int n = static_cast<int>(params.size());
+				edge.verts.push_back(run_w ? corner(f, s) : corner(s, f));
+				for (int i = 1; i + 1 < n; ++i)
+				{
+					const T u = run_w ? c : params[i];
+					const T w = run_w ? params[i] : c;
+					T p[3];
+					Evaluate(u, w, p);
+					edge.verts.push_back(add_vertex(u, w, p));
+				}
+				edge.verts.push_back(run_w ? corner(f, s + 1) : corner(s + 1, f));
+				edge.params = params;
+			}
+		}
+	}
+
+	// each patch: its grid zipped to its four edges
+	std::vector<int> inner;
+	std::vector<T> inner_t;
+	for (int su = 0; su < nsu; ++su)
+	{
+		for (int sw = 0; sw < nsw; ++sw)
+		{
+			const std::vector<T>& us = grid_u[su * nsw + sw];
+			const std::vector<T>& ws = grid_w[su * nsw + sw];
+
+			// interior grid, without the border rows and columns; the seeds
+			// cut each patch in at least two, so it is never empty
+			const int nu = static_cast<int>(us.size()) - 2;
+			const int nw = static_cast<int>(ws.size()) - 2;
+			const int grid = mesh.GetVertexNum();
+			for (int i = 0; i < nu; ++i)
+			{
+				for (int j = 0; j < nw; ++j)
+				{
+					T p[3];
+					Evaluate(us[i + 1], ws[j + 1], p);
+					add_vertex(us[i + 1], ws[j + 1], p);
+				}
+			}
+			for (int i = 0; i + 1 < nu; ++i)
+			{
+				for (int j = 0; j + 1 < nw; ++j)
+				{
+					const int a = grid + i * nw + j;
+					add_triangle(a, a + nw, a + nw + 1);
+					add_triangle(a, a + nw + 1, a + 1);
+				}
+			}
+
+			for (int side = 0; side < 4; ++side)
+			{
+				const bool run_w = side < 2;
+				const bool at_end = side % 2 == 1;
+				const Edge& edge = run_w ? edges_w[(su + at_end) * nsw + sw]
+					: edges_u[(sw + at_end) * nsu + su];
+
+				// first interior row or column along this edge
+				inner.clear();
+				inner_t.clear();
+				const int count = run_w ? nw : nu;
+				for (int i = 0; i < count; ++i)
+				{
+					if (run_w) {
+						inner.push_back(grid + (at_end ? nu - 1 : 0) * nw + i);
+						inner_t.push_back(ws[i + 1]);
+					} else {
+						inner.push_back(grid + i * nw + (at_end ? nw - 1 : 0));
+						inner_t.push_back(us[i + 1]);
+					}
+				}
+
+				// zip the two polylines, always advancing the one that lags
+				size_t i = 0, j = 0;
+				while (i + 1 < edge.verts.size() || j + 1 < inner.size())
+				{
+					if (j + 1 == inner.size() || (i + 1 < edge.verts.size() && edge.params[i + 1] <= inner_t[j + 1])) {
+						add_triangle(edge.verts[i], edge.verts[i + 1], inner[j]);
+						++i;
+					} else {
+						add_triangle(edge.verts[i], inner[j + 1], inner[j]);
+						++j;
+					}
+				}
+			}
+		}
+	}
+}
+
+template <typename T>
+void NurbsSurface<T>::DerivsFromBasis(int uspan, const T* ubasis, int wspan, const T* wbasis,
+	                                  int nders, T* skl, T* aw) const
+{
+	const int k = m_order_u;
+	const int l = m_order_w;
+	const int d1 = nders + 1;
+	const bool rational = IsRational();
+
+	// partials of (hx, hy, hz, h), one pass over the k x l block
+	for (int i = 0; i < d1 * d1 * 4; ++i) {
+		aw[i] = 0;
+	}
+	for (int i = 0; i < k; ++i)
+	{
+		const int row = (uspan - k + 1 + i) * m_mpts + (wspan - l + 1);
+		for (int j = 0; j < l; ++j)
+		{
+			const T* src = &m_net[(row + j) * 3];
+			const T h = rational ? m_weights[row + j] : T(1);
+			for (int a = 0; a <= nders; ++a)
+			{
+				const T nh = ubasis[a * k + i] * h;
+				for (int b = 0; a + b <= nders; ++b)
+				{
+					const T bh = nh * wbasis[b * l + j];
+					T* dst = &aw[(a * d1 + b) * 4];
+					dst[0] += bh * src[0];
+					dst[1] += bh * src[1];
+					dst[2] += bh * src[2];
+					dst[3] += bh;
+				}
+			}
+		}
+	}
+
+	if (!rational)
+	{
+		for (int a = 0; a <= nders; ++a) {
+			for (int b = 0; a + b <= nders; ++b) {
+				for (int c = 0; c < 3; ++c) {
+					skl[(a * d1 + b) * 3 + c] = aw[(a * d1 + b) * 4 + c];
+				}
+			}
+		}
+		return;
+	}
+
+	// quotient rule, NURBS Book A4.4
+	auto h = [&](int a, int b) { return aw[(a * d1 + b) * 4 + 3]; };
+	auto s = [&](int a, int b, int c) { return skl[(a * d1 + b) * 3 + c]; };
+	for (int a = 0; a <= nders; ++a)
+	{
+		for (int b = 0; a + b <= nders; ++b)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				T v = aw[(a * d1 + b) * 4 + c];
+				for (int j = 1; j <= b; ++j) {
+					v -= aitn::binomial<T>(b, j) * h(0, j) * s(a, b - j, c);
+				}
+				for (int i = 1; i <= a; ++i)
+				{
+					v -= aitn::binomial<T>(a, i) * h(i, 0) * s(a - i, b, c);
+					T v2 = 0;
+					for (int j = 1; j <= b; ++j) {
+						v2 += aitn::binomial<T>(b, j) * h(i, j) * s(a - i, b - j, c);
+					}
+					v -= aitn::binomial<T>(a, i) * v2;
+				}
+				skl[(a * d1 + b) * 3 + c] = h(0, 0) != 0 ? v / h(0, 0) : 0;
+			}
+		}
+	}
+}
+
+template <typename T>
+void NurbsSurface<T>::WriteVertex(int format, int nders, const T* skl, T* out)
+{
+	const int d1 = nders + 1;
+	auto put = [&](int a, int b) {
+		const T* src = &skl[(a * d1 + b) * 3];
+		out[0] = src[0];
+		out[1] = src[1];
+		out[2] = src[2];
+		out += 3;
+	};
+
+	if (format & SURF_POSITION) {
+		put(0, 0);
+	}
+	if (format & SURF_NORMAL)
+	{
+		const T* su = &skl[d1 * 3];
+		const T* sw = &skl[3];
+		T n[3] = {
+			su[1] * sw[2] - su[2] * sw[1],
+			su[2] * sw[0] - su[0] * sw[2],
+			su[0] * sw[1] - su[1] * sw[0],
+		};
+		const T len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		for (int c = 0; c < 3; ++c) {
+			out[c] = len > 0 ? n[c] / len : 0;
+		}
+		out += 3;
+	}
+	if (format & SURF_DU) {
+		put(1, 0);
+	}
+	if (format & SURF_DW) {
+		put(0, 1);
+	}
+	if (format & SURF_DUU) {
+		put(2, 0);
+	}
+	if (format & SURF_DUW) {
+		put(1, 1);
+	}
+	if (format & SURF_DWW) {
+		put(0, 2);
+	}
+}
+
+template <typename T>
+bool NurbsSurface<T>::IsClamped(int order, int npts, const std::vector<T>& knots)
+{
+	for (int i = 1; i < order; ++i) {
+		if (knots[i] != knots[0] || knots[npts + i] != knots[npts]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+}
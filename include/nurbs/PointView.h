@@ -0,0 +1,70 @@
+#pragma once
+
+#include <../sm/SM_Vector.h>
+
+#include <cstddef>
+#include <type_traits>
+
+namespace nurbs
+{
+
+// Non-owning view of caller memory holding `count` points of `dim`
+// components. Interleaved (sm::vec2, sm::vec3, any struct) and separate
+// per-component arrays are both described by a base pointer per component
+// and a byte stride between consecutive points.
+template <typename T>
+struct PointView
+{
+	T*     comp[3];
+	size_t stride;
+	int    count;
+	int    dim;
+
+	T& At(int i, int c) const {
+		typedef typename std::conditional<std::is_const<T>::value, const char, char>::type byte;
+		return *reinterpret_cast<T*>(reinterpret_cast<byte*>(comp[c]) + stride * i);
+	}
+
+}; // PointView
+
+template <typename T>
+PointView<T> make_view(T* x, T* y, T* z, size_t stride, int count)
+{
+	PointView<T> v;
+	v.comp[0] = x;
+	v.comp[1] = y;
+	v.comp[2] = z;
+	v.stride  = stride;
+	v.count   = count;
+	v.dim     = z ? 3 : 2;
+	return v;
+}
+
+// structure of arrays, z may be null for 2D data
+template <typename T>
+PointView<T> make_soa_view(T* x, T* y, T* z, int count)
+{
+	return make_view(x, y, z, sizeof(T), count);
+}
+
+inline PointView<const float> make_view(const sm::vec2* pts, int count)
+{
+	return make_view(&pts->x, &pts->y, static_cast<const float*>(nullptr), sizeof(sm::vec2), count);
+}
+
+inline PointView<float> make_view(sm::vec2* pts, int count)
+{
+	return make_view(&pts->x, &pts->y, static_cast<float*>(nullptr), sizeof(sm::vec2), count);
+}
+
+inline PointView<const float> make_view(const sm::vec3* pts, int count)
+{
+	return make_view(&pts->x, &pts->y, &pts->z, sizeof(sm::vec3), count);
+}
+
+inline PointView<float> make_view(sm::vec3* pts, int count)
+{
+	return make_view(&pts->x, &pts->y, &pts->z, sizeof(sm::vec3), count);
+}
+
+}
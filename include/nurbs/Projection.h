@@ -0,0 +1,157 @@
+#pragma once
+
+#include "nurbs/NurbsCurve.h"
+#include "nurbs/NurbsSurface.h"
+#include "nurbs/BoxTree.h"
+#include "nurbs/Extraction.h"
+#include "nurbs/StackBuffer.h"
+
+#include <vector>
+
+namespace nurbs
+{
+
+class ThreadPool;
+
+// Closest point of a curve, t its parameter and dist the distance to the
+// query point
+template <typename T>
+struct CurvePoint
+{
+	T t;
+	T point[3];
+	T dist;
+};
+
+template <typename T>
+struct SurfacePoint
+{
+	T u, w;
+	T point[3];
+	T dist;
+};
+
+// Point inversion for one curve. The BezierSegments of the curve are
+// split until the box around their control points is small next to
+// the whole curve; with positive weights each piece lies in the convex hull
+// of its points, so the boxes go into a BoxTree built once, next to a
+// tighter cylinder slice along the chord of each piece.
+// A query visits the pieces nearest first and runs Newton iteration on
+// C'(t) . (C(t) - p) = 0 from each local minimum of a few cached samples,
+// walking on into the next span where the distance keeps falling; C and
+// its derivatives come from the Bezier points of the span. Curves of few
+// spans skip the tree: walking it costs more than scanning the samples its
+// leaves would hold and iterating from the nearest ones.
+// The result is the nearest of those minima: on nets folded so tightly
+// that the distance dips between samples a closer point can be missed.
+template <typename T>
+class CurveProjector
+{
+public:
+	explicit CurveProjector(const NurbsCurve<T>& curve);
+	// curves of up to dense_spans nonempty spans are scanned instead of
+	// put in a tree, the constructor above passes PROJECT_DENSE_SPANS
+	CurveProjector(const NurbsCurve<T>& curve, int dense_spans);
+
+	const NurbsCurve<T>& GetCurve() const { return m_curve; }
+
+	// false for an invalid curve, result.dist is then the largest T
+	bool Project(const T* p, CurvePoint<T>& result) const;
+
+	// count points of (x, y, z), in tasks of `chunk` queries on the pool;
+	// false as above, with every dist set
+	bool Project(const T* pts, int count, CurvePoint<T>* results, ThreadPool& pool,
+		int chunk = 256) const;
+
+private:
+	// add the leaves of the piece [t0, t1] of span, bez holds its order
+	// homogeneous Bezier points
+	void AddPiece(int span, T t0, T t1, const T* bez, int depth,
+		std::vector<T>& boxes);
+
+	// the samples of a curve with few spans, in place of the tree
+	void AddDense();
+	void ProjectDense(const T* p, CurvePoint<T>& result) const;
+
+	// C, C' and C'' at t in span from its Bezier points, work holds order * 4
+	void SpanDerivs(int span, T t, T* work, T* ders) const;
+
+	// Newton iteration from the seed, clamped to the span it is in
+	void Refine(const T* p, int span, T t, CurvePoint<T>& best) const;
+
+private:
+	NurbsCurve<T> m_curve;
+
+	// the Bezier points Newton iteration evaluates, the segment of each
+	// nonempty span and -1 for the others
+	BezierSegments<T> m_segments;
+	std::vector<int> m_span_segments;
+
+	// pieces no larger than this are not split any more
+	T m_leaf_size;
+
+	// per leaf: its span, PROJECT_CURVE_SEEDS samples of (t, x, y, z) and
+	// the frame bounding it along its chord, no frames when scanned
+	std::vector<int> m_leaf_spans;
+	std::vector<T> m_samples;
+	std::vector<T> m_frames;
+
+	BoxTree<T> m_tree;
+
+	// scanned instead of the tree, one leaf per sample with its tangent;
+	// no point of the curve is much farther than m_gap from its nearest
+	// sample, m_kinks marks the first sample past a knot where the tangent
+	// can turn
+	bool m_dense;
+	T m_gap;
+	std::vector<T> m_tangents;
+	std::vector<bool> m_kinks;
+
+	// two points closer than this coincide
+	T m_eps;
+
+}; // CurveProjector
+
+// Surface version over the BezierPatches of the surface. Newton
+// iteration solves Su . r = Sw . r = 0 for r = S(u, w) - p with the second
+// partials in the Jacobian.
+template <typename T>
+class SurfaceProjector
+{
+public:
+	explicit SurfaceProjector(const NurbsSurface<T>& surface);
+
+	const NurbsSurface<T>& GetSurface() const { return m_surface; }
+
+	bool Project(const T* p, SurfacePoint<T>& result) const;
+
+	bool Project(const T* pts, int count, SurfacePoint<T>* results, ThreadPool& pool,
+		int chunk = 64) const;
+
+private:
+	// bez holds order_u x order_w homogeneous points, w varying fastest
+	void AddPiece(int uspan, int wspan, const T* range, const T* bez, int depth,
+		std::vector<T>& boxes);
+
+	void Refine(const T* p, int uspan, int wspan, T u, T w, SurfacePoint<T>& best) const;
+
+private:
+	NurbsSurface<T> m_surface;
+
+	T m_leaf_size;
+
+	// per leaf: its span pair, a grid of PROJECT_SURFACE_SEEDS squared
+	// samples of (u, w, x, y, z) and the frame bounding it along its normal
+	std::vector<int> m_leaf_spans;
+	std::vector<T> m_samples;
+	std::vector<T> m_frames;
+
+	BoxTree<T> m_tree;
+
+	T m_eps;
+
+}; // SurfaceProjector
+
+}
+
+#include "nurbs/Projection.inl"
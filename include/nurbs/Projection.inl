@@ -0,0 +1,904 @@
+#pragma once
+
+#include "nurbs/ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace nurbs
+{
+
+const int PROJECT_MAX_ITER    = 16;
+const int PROJECT_MAX_HALVING = 8;
+// pieces are split until their box is 1 / PROJECT_LEAF_FRACTION of the
+// whole, or PROJECT_MAX_DEPTH times
+const int PROJECT_LEAF_FRACTION = 32;
+const int PROJECT_MAX_DEPTH     = 10;
+// per leaf: center, unit axis, extent along the axis and radius around it
+const int PROJECT_FRAME_SIZE    = 9;
+// samples per leaf, evenly inside the piece so neighbours share none
+const int PROJECT_CURVE_SEEDS   = 3;
+const int PROJECT_SURFACE_SEEDS = 2;	// per direction
+// Curves of up to PROJECT_DENSE_SPANS nonempty spans are not put in a tree,
+// every query scans all the samples the leaves would hold: on the bench's
+// helix both cost the same at about 128 control points, below that the
+// tree walk costs more than the scan.
+const int PROJECT_DENSE_SPANS = 96;
+
+template <typename T>
+T project_dot(const T* a, const T* b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+template <typename T>
+T project_dist2(const T* a, const T* b)
+{
+	const T d[3] = { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+	return project_dot(d, d);
+}
+
+// grow box (min x, y, z, max x, y, z) by p, an empty box has min > max
+template <typename T>
+void project_extend(T* box, const T* p)
+{
+	for (int c = 0; c < 3; ++c) {
+		box[c] = std::min(box[c], p[c]);
+		box[3 + c] = std::max(box[3 + c], p[c]);
+	}
+}
+
+template <typename T>
+void project_empty(T* box)
+{
+	for (int c = 0; c < 3; ++c) {
+		box[c] = std::numeric_limits<T>::max();
+		box[3 + c] = -std::numeric_limits<T>::max();
+	}
+}
+
+// grow box by count homogeneous points (wx, wy, wz, w), `stride` values apart
+template <typename T>
+void project_hull_box(const T* hpts, int count, int stride, T* box)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		const T* h = hpts + i * stride;
+		const T p[3] = { h[0] / h[3], h[1] / h[3], h[2] / h[3] };
+		project_extend(box, p);
+	}
+}
+
+template <typename T>
+T project_diag(const T* box)
+{
+	return std::sqrt(project_dist2(box, box + 3));
+}
+
+// coincidence distance for points within a box
+template <typename T>
+T project_eps(const T* box)
+{
+	const T diag = project_diag(box);
+	return (diag > 0 ? diag : T(1)) * std::numeric_limits<T>::epsilon() * 16;
+}
+
+// Frame of count homogeneous points around the box center c along axis a,
+// or the longest box axis where a has no length: the range of (P - c) . a
+// and the largest distance of P from the axis. With positive weights the
+// piece lies in the hull of its points and so in that slice of a cylinder,
+// which bounds the distance far tighter than the box where the piece is
+// flat (a surface normal) or straight (a curve chord) but not axis aligned.
+template <typename T>
+void project_frame(const T* hpts, int count, int stride, const T* box, const T* a, T* frame)
+{
+	T* c = frame;
+	T* axis = frame + 3;
+	for (int i = 0; i < 3; ++i) {
+		c[i] = (box[i] + box[3 + i]) / 2;
+	}
+
+	const T len = std::sqrt(project_dot(a, a));
+	if (len > 0)
+	{
+		for (int i = 0; i < 3; ++i) {
+			axis[i] = a[i] / len;
+		}
+	}
+	else
+	{
+		int longest = 0;
+		for (int i = 1; i < 3; ++i) {
+			if (box[3 + i] - box[i] > box[3 + longest] - box[longest]) {
+				longest = i;
+			}
+		}
+		axis[0] = axis[1] = axis[2] = 0;
+		axis[longest] = 1;
+	}
+
+	T hmin = std::numeric_limits<T>::max(), hmax = -hmin, radius2 = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		const T* h = hpts + i * stride;
+		const T d[3] = { h[0] / h[3] - c[0], h[1] / h[3] - c[1], h[2] / h[3] - c[2] };
+		const T along = project_dot(d, axis);
+		hmin = std::min(hmin, along);
+		hmax = std::max(hmax, along);
+		radius2 = std::max(radius2, project_dot(d, d) - along * along);
+	}
+	frame[6] = hmin;
+	frame[7] = hmax;
+	frame[8] = std::sqrt(radius2);
+}
+
+// squared distance of p to the cylinder slice of a frame, 0 inside
+template <typename T>
+T project_frame_dist2(const T* frame, const T* p)
+{
+	const T d[3] = { p[0] - frame[0], p[1] - frame[1], p[2] - frame[2] };
+	const T along = project_dot(d, frame + 3);
+	const T axial = std::max(T(0), std::max(along - frame[7], frame[6] - along));
+	const T off = std::sqrt(std::max(T(0), project_dot(d, d) - along * along));
+	const T radial = std::max(T(0), off - frame[8]);
+	return axial * axial + radial * radial;
+}
+
+// de Casteljau split at the middle of count homogeneous points `stride`
+// values apart, into left and right of the same layout
+template <typename T>
+void project_split(const T* hpts, int count, int stride, T* left, T* right)
+{
+	for (int i = 0; i < count; ++i) {
+		std::copy(hpts + i * stride, hpts + i * stride + 4, right + i * stride);
+	}
+	std::copy(right, right + 4, left);
+	for (int r = 1; r < count; ++r)
+	{
+		for (int i = 0; i < count - r; ++i) {
+			for (int c = 0; c < 4; ++c) {
+				right[i * stride + c] = (right[i * stride + c] + right[(i + 1) * stride + c]) / 2;
+			}
+		}
+		std::copy(right, right + 4, left + r * stride);
+	}
+}
+
+// C, C' and C'' at u in [0, 1] of count homogeneous Bezier points over a
+// parameter range of length dt, by de Casteljau: the differences of the
+// last three levels are the homogeneous derivatives, the quotient rule
+// turns those into the derivatives of the point. work holds count * 4.
+template <typename T>
+void project_bezier_derivs(const T* hpts, int count, T u, T dt, T* work, T* ders)
+{
+	std::copy(hpts, hpts + count * 4, work);
+	for (int r = count - 1; r > 2; --r) {
+		for (int i = 0; i < r * 4; ++i) {
+			work[i] += u * (work[i + 4] - work[i]);
+		}
+	}
+
+	// three points left, or two for lines
+	const T scale = (count - 1) / dt;
+	T h[3][4] = {};
+	if (count > 2)
+	{
+		for (int c = 0; c < 4; ++c) {
+			h[2][c] = scale * (count - 2) / dt * (work[8 + c] - 2 * work[4 + c] + work[c]);
+			work[c] += u * (work[4 + c] - work[c]);
+			work[4 + c] += u * (work[8 + c] - work[4 + c]);
+		}
+	}
+	for (int c = 0; c < 4; ++c) {
+		h[1][c] = scale * (work[4 + c] - work[c]);
+		h[0][c] = work[c] + u * (work[4 + c] - work[c]);
+	}
+
+	const T inv = 1 / h[0][3];
+	for (int c = 0; c < 3; ++c)
+	{
+		ders[c] = h[0][c] * inv;
+		ders[3 + c] = (h[1][c] - h[1][3] * ders[c]) * inv;
+		ders[6 + c] = (h[2][c] - 2 * h[1][3] * ders[3 + c] - h[2][3] * ders[c]) * inv;
+	}
+}
+
+// nearest nonempty knot span after (dir = 1) or before (dir = -1) span,
+// -1 past the end of the domain
+template <typename T>
+int project_next_span(int order, int npts, const std::vector<T>& knots, int span, int dir)
+{
+	for (span += dir; span >= order - 1 && span < npts; span += dir) {
+		if (knots[span] < knots[span + 1]) {
+			return span;
+		}
+	}
+	return -1;
+}
+
+template <typename T>
+CurveProjector<T>::CurveProjector(const NurbsCurve<T>& curve)
+	: CurveProjector(curve, PROJECT_DENSE_SPANS)
+{
+}
+
+template <typename T>
+CurveProjector<T>::CurveProjector(const NurbsCurve<T>& curve, int dense_spans)
+	: m_curve(curve)
+	, m_leaf_size(0)
+	, m_dense(false)
+	, m_gap(0)
+	, m_eps(0)
+{
+	if (!curve.IsValid()) {
+		return;
+	}
+
+	const int npts = curve.GetNum();
+
+	T all[6];
+	project_empty(all);
+	for (int i = 0; i < npts; ++i) {
+		project_extend(all, curve.GetControlPoint(i));
+	}
+	m_eps = project_eps(all);
+	m_leaf_size = project_diag(all) / PROJECT_LEAF_FRACTION;
+
+	m_segments.Extract(curve);
+	m_span_segments.assign(npts, -1);
+	for (int s = 0; s < m_segments.GetNum(); ++s) {
+		m_span_segments[m_segments.GetSpan(s)] = s;
+	}
+
+	if (m_segments.GetNum() <= dense_spans)
+	{
+		AddDense();
+		return;
+	}
+
+	std::vector<T> boxes;
+	for (int s = 0; s < m_segments.GetNum(); ++s)
+	{
+		T t0, t1;
+		m_segments.GetRange(s, t0, t1);
+		AddPiece(m_segments.GetSpan(s), t0, t1, m_segments.GetPoints(s), 0, boxes);
+	}
+
+	m_tree.Build(boxes.data(), static_cast<int>(m_leaf_spans.size()));
+}
+
+template <typename T>
+void CurveProjector<T>::AddDense()
+{
+	m_dense = true;
+
+	// as many samples per span as the tree's leaves would hold, in curve
+	// order; a point between two samples is about half their chord from the
+	// nearer one, a point past the first or the last up to the whole chord
+	// to the end of the domain
+	const int k = m_curve.GetOrder();
+	const std::vector<T>& x = m_curve.GetKnots();
+	T t0, t1, prev[3];
+	m_curve.GetDomain(t0, t1);
+	m_curve.Evaluate(t0, prev);
+	T half = 1;
+	for (int s = 0; s < m_segments.GetNum(); ++s)
+	{
+		T box[6];
+		project_empty(box);
+		project_hull_box(m_segments.GetPoints(s), k, 4, box);
+		const int seeds = std::max(PROJECT_CURVE_SEEDS,
+			static_cast<int>(std::ceil(PROJECT_CURVE_SEEDS * project_diag(box) / m_leaf_size)));
+
+		// with order - 1 equal knots the tangent can turn at the start
+		const int span = m_segments.GetSpan(s);
+		const bool kink = s > 0 && std::count(x.begin(), x.end(), x[span]) >= k - 1;
+
+		m_segments.GetRange(s, t0, t1);
+		for (int i = 0; i < seeds; ++i)
+		{
+			T sample[4], d[2 * 3];
+			sample[0] = t0 + (t1 - t0) * (2 * i + 1) / (2 * seeds);
+			m_curve.Derivatives(span, sample[0], 1, d);
+			std::copy(d, d + 3, sample + 1);
+			m_samples.insert(m_samples.end(), sample, sample + 4);
+			m_tangents.insert(m_tangents.end(), d + 3, d + 6);
+			m_kinks.push_back(kink && i == 0);
+			m_leaf_spans.push_back(span);
+			m_gap = std::max(m_gap, half * std::sqrt(project_dist2(prev, sample + 1)));
+			std::copy(sample + 1, sample + 4, prev);
+			half = T(0.5);
+		}
+	}
+	T last[3];
+	m_curve.Evaluate(t1, last);
+	m_gap = std::max(m_gap, std::sqrt(project_dist2(prev, last)));
+}
+
+template <typename T>
+void CurveProjector<T>::AddPiece(int span, T t0, T t1, const T* bez, int depth,
+	                             std::vector<T>& boxes)
+{
+	const int k = m_curve.GetOrder();
+	T box[6];
+	project_empty(box);
+	project_hull_box(bez, k, 4, box);
+
+	if (depth < PROJECT_MAX_DEPTH && project_diag(box) > m_leaf_size)
+	{
+		std::vector<T> left(k * 4), right(k * 4);
+		project_split(bez, k, 4, left.data(), right.data());
+		const T mid = (t0 + t1) / 2;
+		AddPiece(span, t0, mid, left.data(), depth + 1, boxes);
+		AddPiece(span, mid, t1, right.data(), depth + 1, boxes);
+		return;
+	}
+
+	boxes.insert(boxes.end(), box, box + 6);
+	m_leaf_spans.push_back(span);
+
+	// along the chord
+	const T* first = bez;
+	const T* last = &bez[(k - 1) * 4];
+	const T chord[3] = {
+		last[0] / last[3] - first[0] / first[3],
+		last[1] / last[3] - first[1] / first[3],
+		last[2] / last[3] - first[2] / first[3]
+	};
+	T frame[PROJECT_FRAME_SIZE];
+	project_frame(bez, k, 4, box, chord, frame);
+	m_frames.insert(m_frames.end(), frame, frame + PROJECT_FRAME_SIZE);
+	for (int s = 0; s < PROJECT_CURVE_SEEDS; ++s)
+	{
+		T sample[4];
+		sample[0] = t0 + (t1 - t0) * (2 * s + 1) / (2 * PROJECT_CURVE_SEEDS);
+		m_curve.Evaluate(sample[0], sample + 1);
+		m_samples.insert(m_samples.end(), sample, sample + 4);
+	}
+}
+
+template <typename T>
+bool CurveProjector<T>::Project(const T* p, CurvePoint<T>& result) const
+{
+	result.dist = std::numeric_limits<T>::max();
+	if (m_dense)
+	{
+		ProjectDense(p, result);
+		return true;
+	}
+	if (m_tree.IsEmpty()) {
+		return false;
+	}
+
+	m_tree.Nearest(p, std::numeric_limits<T>::max(), [&](int leaf, T) {
+		const T bound = result.dist * result.dist;
+		if (project_frame_dist2(&m_frames[leaf * PROJECT_FRAME_SIZE], p) >= bound) {
+			return bound;
+		}
+
+		// iterate from every sample no farther than its neighbours
+		const T* samples = &m_samples[leaf * PROJECT_CURVE_SEEDS * 4];
+		T d2[PROJECT_CURVE_SEEDS];
+		for (int s = 0; s < PROJECT_CURVE_SEEDS; ++s) {
+			d2[s] = project_dist2(samples + s * 4 + 1, p);
+		}
+		for (int s = 0; s < PROJECT_CURVE_SEEDS; ++s)
+		{
+			if ((s > 0 && d2[s - 1] < d2[s]) || (s + 1 < PROJECT_CURVE_SEEDS && d2[s + 1] < d2[s])) {
+				continue;
+			}
+			Refine(p, m_leaf_spans[leaf], samples[s * 4], result);
+		}
+		return result.dist * result.dist;
+	});
+	return true;
+}
+
+template <typename T>
+bool CurveProjector<T>::Project(const T* pts, int count, CurvePoint<T>* results,
+	                            ThreadPool& pool, int chunk) const
+{
+	if (!m_dense && m_tree.IsEmpty())
+	{
+		for (int i = 0; i < count; ++i) {
+			results[i].dist = std::numeric_limits<T>::max();
+		}
+		return false;
+	}
+	if (count <= 0) {
+		return true;
+	}
+	chunk = std::max(chunk, 1);
+	const int tasks = (count + chunk - 1) / chunk;
+	pool.ParallelFor(tasks, [&](int task) {
+		const int end = std::min(count, (task + 1) * chunk);
+		for (int i = task * chunk; i < end; ++i) {
+			Project(pts + i * 3, results[i]);
+		}
+	});
+	return true;
+}
+
+template <typename T>
+void CurveProjector<T>::ProjectDense(const T* p, CurvePoint<T>& result) const
+{
+	const int count = static_cast<int>(m_samples.size()) / 4;
+	// on the stack for the sample counts of the usual scanned curves
+	StackBuffer<T, 1024> buffer(count);
+	T* d2 = buffer.Data();
+	int nearest = 0;
+	T nearest_d2 = std::numeric_limits<T>::max();
+	for (int i = 0; i < count; ++i)
+	{
+		d2[i] = project_dist2(&m_samples[i * 4 + 1], p);
+		if (d2[i] < nearest_d2)
+		{
+			nearest = i;
+			nearest_d2 = d2[i];
+		}
+	}
+
+	// The nearest sample first, then the others while a point within the
+	// gap of them can still be closer: the local minima, and the samples
+	// where the distance falls towards a nearer neighbour but grows that way
+	// along the tangent, so that it dips in between. Iteration stops at a
+	// kink, the samples on either side of one are not neighbours.
+	Refine(p, m_leaf_spans[nearest], m_samples[nearest * 4], result);
+	T reach = result.dist + m_gap;
+	for (int i = 0; i < count; ++i)
+	{
+		if (d2[i] >= reach * reach || i == nearest) {
+			continue;
+		}
+		const T* s = &m_samples[i * 4 + 1];
+		const T r[3] = { s[0] - p[0], s[1] - p[1], s[2] - p[2] };
+		const T f = project_dot(&m_tangents[i * 3], r);
+		if ((i > 0 && !m_kinks[i] && d2[i - 1] < d2[i] && f > 0)
+			|| (i + 1 < count && !m_kinks[i + 1] && d2[i + 1] < d2[i] && f < 0)) {
+			continue;
+		}
+		Refine(p, m_leaf_spans[i], m_samples[i * 4], result);
+		reach = result.dist + m_gap;
+	}
+}
+
+template <typename T>
+void CurveProjector<T>::SpanDerivs(int span, T t, T* work, T* ders) const
+{
+	const int s = m_span_segments[span];
+	T t0, t1;
+	m_segments.GetRange(s, t0, t1);
+	project_bezier_derivs(m_segments.GetPoints(s), m_curve.GetOrder(), (t - t0) / (t1 - t0), t1 - t0, work, ders);
+}
+
+template <typename T>
+void CurveProjector<T>::Refine(const T* p, int span, T t, CurvePoint<T>& best) const
+{
+	const std::vector<T>& x = m_curve.GetKnots();
+	T t0 = x[span], t1 = x[span + 1];
+	// |cos| of the angle between C' and C - p counted as perpendicular
+	const T cos_eps = std::sqrt(std::numeric_limits<T>::epsilon());
+
+	StackBuffer<T, 4 * MAX_STACK_ORDER> buffer(m_curve.GetOrder() * 4);
+	T* work = buffer.Data();
+
+	T d[3 * 3], trial[3 * 3];
+	SpanDerivs(span, t, work, d);
+	T dist = std::sqrt(project_dist2(d, p));
+	for (int iter = 0; iter < PROJECT_MAX_ITER && dist > m_eps; ++iter)
+	{
+		// Newton step on f(t) = C' . r, NURBS Book eq. 6.3
+		const T r[3] = { d[0] - p[0], d[1] - p[1], d[2] - p[2] };
+		const T f = project_dot(d + 3, r);
+		const T speed2 = project_dot(d + 3, d + 3);
+		if (std::abs(f) <= cos_eps * std::sqrt(speed2) * dist) {
+			break;
+		}
+
+		// At the end of the span with the distance still falling: go on in
+		// the next span, unless this is the end of the domain or a kink
+		// whose other side points straight back.
+		if ((t <= t0 && f > 0) || (t >= t1 && f < 0))
+		{
+			const int next = project_next_span(m_curve.GetOrder(), m_curve.GetNum(), x, span, f > 0 ? -1 : 1);
+			if (next < 0) {
+				break;
+			}
+			SpanDerivs(next, t, work, trial);
+			const T next_f = project_dot(trial + 3, r);
+			if ((f > 0 && next_f < 0) || (f < 0 && next_f > 0)) {
+				break;
+			}
+			span = next;
+			t0 = x[span];
+			t1 = x[span + 1];
+			std::copy(trial, trial + 9, d);
+			continue;
+		}
+
+		// away from the minimum the curvature term can make f' negative,
+		// the Gauss-Newton step without it still goes downhill
+		T df = project_dot(d + 6, r) + speed2;
+		if (df <= 0) {
+			df = speed2;
+		}
+
+		// halve the step until the distance drops
+		bool moved = false;
+		T step = -f / df;
+		for (int i = 0; i < PROJECT_MAX_HALVING && !moved; ++i, step /= 2)
+		{
+			const T next = std::min(std::max(t + step, t0), t1);
+			if (std::abs(next - t) * std::sqrt(speed2) <= m_eps) {
+				break;
+			}
+			SpanDerivs(span, next, work, trial);
+			const T trial_dist = std::sqrt(project_dist2(trial, p));
+			if (trial_dist < dist)
+			{
+				t = next;
+				std::copy(trial, trial + 9, d);
+				dist = trial_dist;
+				moved = true;
+			}
+		}
+		if (!moved) {
+			break;
+		}
+	}
+
+	if (dist < best.dist)
+	{
+		best.t = t;
+		std::copy(d, d + 3, best.point);
+		best.dist = dist;
+	}
+}
+
+template <typename T>
+SurfaceProjector<T>::SurfaceProjector(const NurbsSurface<T>& surface)
+	: m_surface(surface)
+	, m_leaf_size(0)
+	, m_eps(0)
+{
+	if (!surface.IsValid()) {
+		return;
+	}
+
+	const int npts = surface.GetNumU();
+	const int mpts = surface.GetNumW();
+
+	T all[6];
+	project_empty(all);
+	for (int i = 0; i < npts; ++i) {
+		for (int j = 0; j < mpts; ++j) {
+			project_extend(all, surface.GetControlPoint(i, j));
+		}
+	}
+	m_eps = project_eps(all);
+	m_leaf_size = project_diag(all) / PROJECT_LEAF_FRACTION;
+
+	const BezierPatches<T> patches(surface);
+	std::vector<T> boxes;
+	for (int su = 0; su < patches.GetNumU(); ++su)
+	{
+		for (int sw = 0; sw < patches.GetNumW(); ++sw)
+		{
+			T range[4];
+			patches.GetRangeU(su, range[0], range[1]);
+			patches.GetRangeW(sw, range[2], range[3]);
+			AddPiece(patches.GetSpanU(su), patches.GetSpanW(sw), range, patches.GetPoints(su, sw), 0, boxes);
+		}
+	}
+
+	m_tree.Build(boxes.data(), static_cast<int>(m_leaf_spans.size() / 2));
+}
+
+template <typename T>
+void SurfaceProjector<T>::AddPiece(int uspan, int wspan, const T* range, const T* bez,
+	                               int depth, std::vector<T>& boxes)
+{
+	const int k = m_surface.GetOrderU();
+	const int l = m_surface.GetOrderW();
+	T box[6];
+	project_empty(box);
+	project_hull_box(bez, k * l, 4, box);
+
+	if (depth < PROJECT_MAX_DEPTH && project_diag(box) > m_leaf_size)
+	{
+		// split across the direction whose control polygons are longer
+		T len_u = 0, len_w = 0;
+		for (int i = 0; i < k; ++i)
+		{
+			for (int j = 0; j < l; ++j)
+			{
+				const T* h = &bez[(i * l + j) * 4];
+				const T pt[3] = { h[0] / h[3], h[1] / h[3], h[2] / h[3] };
+				if (i > 0)
+				{
+					const T* g = h - l * 4;
+					const T prev[3] = { g[0] / g[3], g[1] / g[3], g[2] / g[3] };
+					len_u += std::sqrt(project_dist2(pt, prev));
+				}
+				if (j > 0)
+				{
+					const T* g = h - 4;
+					const T prev[3] = { g[0] / g[3], g[1] / g[3], g[2] / g[3] };
+					len_w += std::sqrt(project_dist2(pt, prev));
+				}
+			}
+		}
+
+		std::vector<T> left(k * l * 4), right(k * l * 4);
+		T lrange[4], rrange[4];
+		std::copy(range, range + 4, lrange);
+		std::copy(range, range + 4, rrange);
+		// compare the average polygon per row and per column
+		if (len_u * l >= len_w * k)
+		{
+			for (int j = 0; j < l; ++j) {
+				project_split(&bez[j * 4], k, l * 4, &left[j * 4], &right[j * 4]);
+			}
+			lrange[1] = rrange[0] = (range[0] + range[1]) / 2;
+		}
+		else
+		{
+			for (int i = 0; i < k; ++i) {
+				project_split(&bez[i * l * 4], l, 4, &left[i * l * 4], &right[i * l * 4]);
+			}
+			lrange[3] = rrange[2] = (range[2] + range[3]) / 2;
+		}
+		AddPiece(uspan, wspan, lrange, left.data(), depth + 1, boxes);
+		AddPiece(uspan, wspan, rrange, right.data(), depth + 1, boxes);
+		return;
+	}
+
+	boxes.insert(boxes.end(), box, box + 6);
+	m_leaf_spans.push_back(uspan);
+	m_leaf_spans.push_back(wspan);
+
+	// along the normal of the corner diagonals
+	const T* c00 = &bez[0];
+	const T* c01 = &bez[(l - 1) * 4];
+	const T* c10 = &bez[(k - 1) * l * 4];
+	const T* c11 = &bez[(k * l - 1) * 4];
+	T d0[3], d1[3];
+	for (int c = 0; c < 3; ++c) {
+		d0[c] = c11[c] / c11[3] - c00[c] / c00[3];
+		d1[c] = c01[c] / c01[3] - c10[c] / c10[3];
+	}
+	const T normal[3] = {
+		d0[1] * d1[2] - d0[2] * d1[1],
+		d0[2] * d1[0] - d0[0] * d1[2],
+		d0[0] * d1[1] - d0[1] * d1[0]
+	};
+	T frame[PROJECT_FRAME_SIZE];
+	project_frame(bez, k * l, 4, box, normal, frame);
+	m_frames.insert(m_frames.end(), frame, frame + PROJECT_FRAME_SIZE);
+	for (int su = 0; su < PROJECT_SURFACE_SEEDS; ++su)
+	{
+		const T u = range[0] + (range[1] - range[0]) * (2 * su + 1) / (2 * PROJECT_SURFACE_SEEDS);
+		for (int sw = 0; sw < PROJECT_SURFACE_SEEDS; ++sw)
+		{
+			T sample[5];
+			sample[0] = u;
+			sample[1] = range[2] + (range[3] - range[2]) * (2 * sw + 1) / (2 * PROJECT_SURFACE_SEEDS);
+			m_surface.Evaluate(sample[0], sample[1], sample + 2);
+			m_samples.insert(m_samples.end(), sample, sample + 5);
+		}
+	}
+}
+
+template <typename T>
+bool SurfaceProjector<T>::Project(const T* p, SurfacePoint<T>& result) const
+{
+	if (m_tree.IsEmpty())
+	{
+		result.dist = std::numeric_limits<T>::max();
+		return false;
+	}
+
+	const int n = PROJECT_SURFACE_SEEDS;
+	result.dist = std::numeric_limits<T>::max();
+	m_tree.Nearest(p, std::numeric_limits<T>::max(), [&](int leaf, T) {
+		const T bound = result.dist * result.dist;
+		if (project_frame_dist2(&m_frames[leaf * PROJECT_FRAME_SIZE], p) >= bound) {
+			return bound;
+		}
+
+		// every sample no farther than its grid neighbours is a seed
+		const T* samples = &m_samples[leaf * n * n * 5];
+		T d2[PROJECT_SURFACE_SEEDS * PROJECT_SURFACE_SEEDS];
+		for (int s = 0; s < n * n; ++s) {
+			d2[s] = project_dist2(samples + s * 5 + 2, p);
+		}
+		for (int su = 0; su < n; ++su)
+		{
+			for (int sw = 0; sw < n; ++sw)
+			{
+				const int s = su * n + sw;
+				if ((su > 0 && d2[s - n] < d2[s]) || (su + 1 < n && d2[s + n] < d2[s])
+				 || (sw > 0 && d2[s - 1] < d2[s]) || (sw + 1 < n && d2[s + 1] < d2[s])) {
+					continue;
+				}
+				Refine(p, m_leaf_spans[leaf * 2], m_leaf_spans[leaf * 2 + 1],
+					samples[s * 5], samples[s * 5 + 1], result);
+			}
+		}
+		return result.dist * result.dist;
+	});
+	return true;
+}
+
+template <typename T>
+bool SurfaceProjector<T>::Project(const T* pts, int count, SurfacePoint<T>* results,
+	                              ThreadPool& pool, int chunk) const
+{
+	if (m_tree.IsEmpty())
+	{
+		for (int i = 0; i < count; ++i) {
+			results[i].dist = std::numeric_limits<T>::max();
+		}
+		return false;
+	}
+	if (count <= 0) {
+		return true;
+	}
+	chunk = std::max(chunk, 1);
+	const int tasks = (count + chunk - 1) / chunk;
+	pool.ParallelFor(tasks, [&](int task) {
+		const int end = std::min(count, (task + 1) * chunk);
+		for (int i = task * chunk; i < end; ++i) {
+			Project(pts + i * 3, results[i]);
+		}
+	});
+	return true;
+}
+
+template <typename T>
+void SurfaceProjector<T>::Refine(const T* p, int uspan, int wspan, T u, T w,
+	                             SurfacePoint<T>& best) const
+{
+	const std::vector<T>& x = m_surface.GetKnotsU();
+	const std::vector<T>& y = m_surface.GetKnotsW();
+	const T cos_eps = std::sqrt(std::numeric_limits<T>::epsilon());
+
+	// skl[(a * 3 + b) * 3] = d^(a+b) S / du^a dw^b
+	T skl[3 * 3 * 3], trial[3 * 3 * 3];
+	const T* s   = skl;
+	const T* sw  = skl + 3;
+	const T* sww = skl + 6;
+	const T* su  = skl + 9;
+	const T* suw = skl + 12;
+	const T* suu = skl + 18;
+
+	m_surface.Derivatives(uspan, wspan, u, w, 2, skl);
+	T dist = std::sqrt(project_dist2(s, p));
+	for (int iter = 0; iter < PROJECT_MAX_ITER && dist > m_eps; ++iter)
+	{
+		const T u0 = x[uspan], u1 = x[uspan + 1];
+		const T w0 = y[wspan], w1 = y[wspan + 1];
+
+		// Newton step on f = Su . r, g = Sw . r, NURBS Book eq. 6.6
+		const T r[3] = { s[0] - p[0], s[1] - p[1], s[2] - p[2] };
+		const T f = project_dot(su, r);
+		const T g = project_dot(sw, r);
+		const T len_u = std::sqrt(project_dot(su, su));
+		const T len_w = std::sqrt(project_dot(sw, sw));
+		if (std::abs(f) <= cos_eps * len_u * dist && std::abs(g) <= cos_eps * len_w * dist) {
+			break;
+		}
+
+		// On the edge of the patch with the distance falling outwards: go on
+		// in the neighbouring patch. At the edge of the domain, or at a kink
+		// whose other side points straight back, keep that parameter and
+		// search along the edge.
+		const bool hold_u = (u <= u0 && f > 0) || (u >= u1 && f < 0);
+		const bool hold_w = (w <= w0 && g > 0) || (w >= w1 && g < 0);
+		if (hold_u)
+		{
+			const int next = project_next_span(m_surface.GetOrderU(), m_surface.GetNumU(), x, uspan, f > 0 ? -1 : 1);
+			if (next >= 0)
+			{
+				m_surface.Derivatives(next, wspan, u, w, 2, trial);
+				const T next_f = project_dot(trial + 9, r);
+				if ((f > 0 && next_f >= 0) || (f < 0 && next_f <= 0))
+				{
+					uspan = next;
+					std::copy(trial, trial + 27, skl);
+					continue;
+				}
+			}
+		}
+		if (hold_w)
+		{
+			const int next = project_next_span(m_surface.GetOrderW(), m_surface.GetNumW(), y, wspan, g > 0 ? -1 : 1);
+			if (next >= 0)
+			{
+				m_surface.Derivatives(uspan, next, u, w, 2, trial);
+				const T next_g = project_dot(trial + 3, r);
+				if ((g > 0 && next_g >= 0) || (g < 0 && next_g <= 0))
+				{
+					wspan = next;
+					std::copy(trial, trial + 27, skl);
+					continue;
+				}
+			}
+		}
+		if (hold_u && hold_w) {
+			break;
+		}
+
+		T j00 = len_u * len_u + project_dot(r, suu);
+		T j01 = project_dot(su, sw) + project_dot(r, suw);
+		T j11 = len_w * len_w + project_dot(r, sww);
+		T du = 0, dw = 0;
+		if (hold_u) {
+			// along the edge, Newton in the free parameter alone
+			dw = -g / (j11 > 0 ? j11 : len_w * len_w);
+		} else if (hold_w) {
+			du = -f / (j00 > 0 ? j00 : len_u * len_u);
+		}
+		else
+		{
+			// Gauss-Newton where the Jacobian is not positive definite
+			T det = j00 * j11 - j01 * j01;
+			if (j00 <= 0 || det <= 0)
+			{
+				j00 = len_u * len_u;
+				j01 = project_dot(su, sw);
+				j11 = len_w * len_w;
+				det = j00 * j11 - j01 * j01;
+				if (det <= 0) {
+					break;
+				}
+			}
+			du = (j01 * g - j11 * f) / det;
+			dw = (j01 * f - j00 * g) / det;
+		}
+
+		// halve the step until the distance drops, then try steepest
+		// descent in case clamping turned the Newton step uphill
+		bool moved = false;
+		for (int attempt = 0; attempt < 2 && !moved; ++attempt)
+		{
+			if (attempt == 1)
+			{
+				du = hold_u ? 0 : -f / (len_u * len_u);
+				dw = hold_w ? 0 : -g / (len_w * len_w);
+			}
+			for (int i = 0; i < PROJECT_MAX_HALVING && !moved; ++i, du /= 2, dw /= 2)
+			{
+				const T next_u = std::min(std::max(u + du, u0), u1);
+				const T next_w = std::min(std::max(w + dw, w0), w1);
+				if (std::abs(next_u - u) * len_u + std::abs(next_w - w) * len_w <= m_eps) {
+					break;
+				}
+				m_surface.Derivatives(uspan, wspan, next_u, next_w, 2, trial);
+				const T trial_dist = std::sqrt(project_dist2(trial, p));
+				if (trial_dist < dist)
+				{
+					u = next_u;
+					w = next_w;
+					std::copy(trial, trial + 27, skl);
+					dist = trial_dist;
+					moved = true;
+				}
+			}
+		}
+		if (!moved) {
+			break;
+		}
+	}
+
+	if (dist < best.dist)
+	{
+		best.u = u;
+		best.w = w;
+		std::copy(s, s + 3, best.point);
+		best.dist = dist;
+	}
+}
+
+}
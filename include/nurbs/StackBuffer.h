@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+namespace nurbs
+{
+
+// stack sizes of the evaluators' scratch: the basis of orders up to 16,
+// the basis derivatives with their workspace for the usual orders
+const int MAX_STACK_ORDER  = 16;
+const int MAX_STACK_DERIVS = 512;
+
+// Per-call scratch of `size` values: on the stack up to N, which covers
+// the usual orders, and on the heap beyond that.
+template <typename T, int N>
+class StackBuffer
+{
+public:
+	explicit StackBuffer(int size)
+		: m_data(m_stack)
+	{
+		if (size > N) {
+			m_heap.resize(size);
+			m_data = m_heap.data();
+		}
+	}
+
+	T* Data() { return m_data; }
+
+private:
+	StackBuffer(const StackBuffer&) = delete;
+	StackBuffer& operator = (const StackBuffer&) = delete;
+
+private:
+	T m_stack[N];
+	std::vector<T> m_heap;
+
+	T* m_data;
+
+}; // StackBuffer
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+namespace nurbs
+{
+
+class ThreadPool;
+
+enum class SurfaceType
+{
+	Bezier,		// aitn::bezsurf, npts x mpts net, degrees npts-1 and mpts-1
+	BSpline,	// aitn::bsplsurf, open knot vectors
+	RBSpline,	// aitn::rbspsurf, net points are (x, y, z, h)
+};
+
+// One tensor-product patch to tessellate into a p1 x p2 grid.
+struct SurfacePatch
+{
+	SurfaceType type;
+
+	const float* net;	// w varying fastest, 3 floats per point (4 for RBSpline)
+	int npts, mpts;
+	int row_stride;		// points between two rows of the net, usually mpts
+	int order_u, order_w;	// ignored for Bezier
+
+	int p1, p2;
+	float* out;			// p1 * p2 * 3 floats
+
+	// Bezier and BSpline: npts x mpts weights, rows row_stride apart,
+	// null for all 1; RBSpline nets carry their own
+	const float* weights;
+};
+
+// Single-threaded reference, evaluates the same tiles in order.
+void tessellate(const SurfacePatch& patch);
+
+// Split every patch into tile x tile sample blocks and spread the blocks
+// of all patches over the pool. The output is bit-identical to
+// tessellate(): each sample is computed by the same code from the same
+// precomputed parameters, whichever thread gets it.
+void tessellate(const SurfacePatch* patches, int count, ThreadPool& pool,
+	int tile = 32);
+
+}
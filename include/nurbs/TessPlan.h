@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+
+namespace nurbs
+{
+
+enum class KnotType
+{
+	Open,		// aitn::knot
+	Periodic,	// aitn::knotu
+};
+
+// Sparse basis matrix of a B-spline sampled at a fixed number of evenly
+// spaced parameter values. Only the control points move between frames, so
+// the matrix is computed once and each evaluation is a sparse product.
+// Row i has `order` nonzero entries starting at column GetStarts()[i].
+class TessPlan
+{
+public:
+	struct Key
+	{
+		int      order;
+		int      npts;
+		int      samples;
+		KnotType knot;
+
+		bool operator == (const Key& key) const {
+			return order == key.order && npts == key.npts
+				&& samples == key.samples && knot == key.knot;
+		}
+	};
+
+	struct KeyHash
+	{
+		size_t operator () (const Key& key) const;
+	};
+
+public:
+	TessPlan(const Key& key);
+
+	const Key& GetKey() const { return m_key; }
+	int GetOrder() const { return m_key.order; }
+	int GetSamples() const { return m_key.samples; }
+
+	const int*   GetStarts() const { return m_starts.data(); }
+	const float* GetBasis() const { return m_basis.data(); }
+	// transposed copy, order x samples, for evaluating several samples at once
+	const float* GetBasisT() const { return m_basis_t.data(); }
+
+	// b holds npts points of dim components, p receives samples points
+	void Eval(const float* b, int dim, float* p) const;
+	// h holds the npts homogeneous weights
+	void EvalRational(const float* b, const float* h, int dim, float* p) const;
+
+	// b holds a u_plan.npts x w_plan.npts net with w varying fastest, rows
+	// are row_stride points apart; q receives u samples x w samples points
+	static void EvalSurface(const TessPlan& u_plan, const TessPlan& w_plan,
+		const float* b, int row_stride, float* q);
+	// only samples [u_begin, u_end) x [w_begin, w_end), q is still the
+	// whole output; tiles give the same values as a full evaluation
+	static void EvalSurface(const TessPlan& u_plan, const TessPlan& w_plan,
+		const float* b, int row_stride, int u_begin, int u_end,
+		int w_begin, int w_end, float* q);
+	// as above, but each net point is (x, y, z, h)
+	static void EvalSurfaceRational(const TessPlan& u_plan, const TessPlan& w_plan,
+		const float* b, int row_stride, float* q);
+	static void EvalSurfaceRational(const TessPlan& u_plan, const TessPlan& w_plan,
+		const float* b, int row_stride, int u_begin, int u_end,
+		int w_begin, int w_end, float* q);
+	// b holds (x, y, z) and h the weights of the same net, both rows
+	// row_stride apart
+	static void EvalSurfaceRational(const TessPlan& u_plan, const TessPlan& w_plan,
+		const float* b, const float* h, int row_stride, int u_begin, int u_end,
+		int w_begin, int w_end, float* q);
+
+private:
+	Key m_key;
+
+	std::vector<int>   m_starts;
+	std::vector<float> m_basis;
+	std::vector<float> m_basis_t;
+
+}; // TessPlan
+
+// Thread-safe LRU cache of plans, shared by the nurbs entry points.
+class TessPlanCache
+{
+public:
+	TessPlanCache(size_t capacity = 64);
+
+	std::shared_ptr<const TessPlan> Fetch(const TessPlan::Key& key);
+
+	void Clear();
+
+	static TessPlanCache& Instance();
+
+private:
+	typedef std::pair<TessPlan::Key, std::shared_ptr<const TessPlan>> Entry;
+
+	size_t m_capacity;
+
+	std::mutex m_mutex;
+	std::list<Entry> m_lru;		// most recently used first
+	std::unordered_map<TessPlan::Key, std::list<Entry>::iterator,
+		TessPlan::KeyHash> m_map;
+
+}; // TessPlanCache
+
+}
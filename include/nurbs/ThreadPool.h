@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace nurbs
+{
+
+// Fixed set of workers with one task queue each. A worker drains its own
+// queue from the back and, once empty, steals from the front of the
+// others, so uneven tasks (tiles of patches of different cost) balance
+// out. The calling thread works too.
+class ThreadPool
+{
+public:
+	// threads = 0 uses one thread per hardware core
+	explicit ThreadPool(int threads = 0);
+	~ThreadPool();
+
+	// workers plus the calling thread
+	int GetThreadNum() const { return static_cast<int>(m_queues.size()); }
+
+	// run func(0) ... func(count - 1) and return when all are done;
+	// calls are serialized, func must not call ParallelFor again
+	void ParallelFor(int count, const std::function<void(int)>& func);
+
+	static ThreadPool& Instance();
+
+private:
+	struct Queue
+	{
+		std::mutex      mutex;
+		std::deque<int> items;
+	};
+
+	bool Pop(int id, int& item);
+	bool Steal(int id, int& item);
+
+	void Work(int id);
+	void WorkerLoop(int id);
+
+private:
+	std::vector<std::unique_ptr<Queue>> m_queues;	// the caller owns the last one
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_run_mutex;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake_cv;
+	std::condition_variable m_done_cv;
+	unsigned int m_generation;
+	bool m_quit;
+
+	const std::function<void(int)>* m_func;
+	std::atomic<int> m_pending;
+
+}; // ThreadPool
+
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "nurbs/PointView.h"
+
 #include <../sm/SM_Vector.h>
 
 #include <vector>
@@ -19,5 +21,19 @@ void bspsurf(const sm::vec3* ctl_pts, int order_u, int order_v,
 	int npts, int mpts, int p1, int p2, std::vector<sm::vec3>& surface);
 void rbspsurf(const sm::vec3* ctl_pts, int order_u, int order_v,
 	int npts, int mpts, int p1, int p2, std::vector<sm::vec3>& surface);
+// weights holds npts * mpts values, null for all 1
+void rbspsurf(const sm::vec3* ctl_pts, const float* weights, int order_u, int order_v,
+	int npts, int mpts, int p1, int p2, std::vector<sm::vec3>& surface);
+
+// Evaluate straight from caller memory into caller memory, nothing is
+// copied or allocated. polyline.count is the number of samples, missing
+// input components read as 0 and weights may be null. Curves with an
+// order outside 2 to ctl_pts.count leave polyline untouched.
+void bezier(const PointView<const float>& ctl_pts,
+	const PointView<float>& polyline);
+void bspline(const PointView<const float>& ctl_pts,
+	int order, const PointView<float>& polyline);
+void rbspline(const PointView<const float>& ctl_pts, const float* weights,
+	int order, const PointView<float>& polyline);
 
 }
\ No newline at end of file
@@ -0,0 +1,413 @@
+#include "../include/nurbs/BatchEval.h"
+#include "../include/nurbs/TessPlan.h"
+
+#include "../external/aitn/rbsp_util.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define NURBS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define NURBS_TARGET(isa) __attribute__((target(isa)))
+#else
+#define NURBS_TARGET(isa)
+#endif
+
+namespace
+{
+
+// dst[s] = sum_r basis_t[r * n + s] * src[starts[s] + r], for s >= begin
+typedef void (*CurveKernel)(const int* starts, const float* basis_t, int n, int k,
+	                        const float* src, float* dst, int begin);
+// dst[j] = sum_r w[r] * src[r * stride + j], for j < n
+typedef void (*RowKernel)(const float* w, int k, const float* src, int stride,
+	                      int n, float* dst, int begin);
+
+void curve_scalar(const int* starts, const float* basis_t, int n, int k,
+	              const float* src, float* dst, int begin)
+{
+	for (int s = begin; s < n; ++s)
+	{
+		const float* p = src + starts[s];
+		float v = 0;
+		for (int r = 0; r < k; ++r) {
+			v += basis_t[r * n + s] * p[r];
+		}
+		dst[s] = v;
+	}
+}
+
+void row_scalar(const float* w, int k, const float* src, int stride,
+	            int n, float* dst, int begin)
+{
+	for (int j = begin; j < n; ++j)
+	{
+		float v = 0;
+		for (int r = 0; r < k; ++r) {
+			v += w[r] * src[r * stride + j];
+		}
+		dst[j] = v;
+	}
+}
+
+#ifdef NURBS_X86
+
+NURBS_TARGET("sse2")
+void curve_sse(const int* starts, const float* basis_t, int n, int k,
+	           const float* src, float* dst, int begin)
+{
+	int s = begin;
+	for ( ; s + 4 <= n; s += 4)
+	{
+		const float* p0 = src + starts[s];
+		const float* p1 = src + starts[s + 1];
+		const float* p2 = src + starts[s + 2];
+		const float* p3 = src + starts[s + 3];
+		__m128 acc = _mm_setzero_ps();
+		for (int r = 0; r < k; ++r)
+		{
+			__m128 g = _mm_set_ps(p3[r], p2[r], p1[r], p0[r]);
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(basis_t + r * n + s), g));
+		}
+		_mm_storeu_ps(dst + s, acc);
+	}
+	curve_scalar(starts, basis_t, n, k, src, dst, s);
+}
+
+NURBS_TARGET("sse2")
+void row_sse(const float* w, int k, const float* src, int stride,
+	         int n, float* dst, int begin)
+{
+	int j = begin;
+	for ( ; j + 4 <= n; j += 4)
+	{
+		__m128 acc = _mm_setzero_ps();
+		for (int r = 0; r < k; ++r) {
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[r]), _mm_loadu_ps(src + r * stride + j)));
+		}
+		_mm_storeu_ps(dst + j, acc);
+	}
+	row_scalar(w, k, src, stride, n, dst, j);
+}
+
+NURBS_TARGET("avx2")
+void curve_avx2(const int* starts, const float* basis_t, int n, int k,
+	            const float* src, float* dst, int begin)
+{
+	int s = begin;
+	for ( ; s + 8 <= n; s += 8)
+	{
+		__m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(starts + s));
+		__m256 acc = _mm256_setzero_ps();
+		for (int r = 0; r < k; ++r)
+		{
+			__m256 g = _mm256_i32gather_ps(src, _mm256_add_epi32(idx, _mm256_set1_epi32(r)), 4);
+			acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(basis_t + r * n + s), g));
+		}
+		_mm256_storeu_ps(dst + s, acc);
+	}
+	curve_sse(starts, basis_t, n, k, src, dst, s);
+}
+
+NURBS_TARGET("avx2")
+void row_avx2(const float* w, int k, const float* src, int stride,
+	          int n, float* dst, int begin)
+{
+	int j = begin;
+	for ( ; j + 8 <= n; j += 8)
+	{
+		__m256 acc = _mm256_setzero_ps();
+		for (int r = 0; r < k; ++r) {
+			acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(w[r]), _mm256_loadu_ps(src + r * stride + j)));
+		}
+		_mm256_storeu_ps(dst + j, acc);
+	}
+	row_sse(w, k, src, stride, n, dst, j);
+}
+
+// the *_round_ forms keep GCC from fusing the multiply and add, avx512f
+// brings FMA with it. Their plain and the plain gather's pass-through
+// operand is _mm512_undefined_ps(), which -Wall flags once inlined, so
+// the zero-masked forms are used with all lanes set.
+const __mmask16 ALL_LANES = 0xffff;
+
+NURBS_TARGET("avx512f")
+void curve_avx512(const int* starts, const float* basis_t, int n, int k,
+	              const float* src, float* dst, int begin)
+{
+	int s = begin;
+	for ( ; s + 16 <= n; s += 16)
+	{
+		__m512i idx = _mm512_loadu_si512(starts + s);
+		__m512 acc = _mm512_setzero_ps();
+		for (int r = 0; r < k; ++r)
+		{
+			__m512 g = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), ALL_LANES,
+				_mm512_add_epi32(idx, _mm512_set1_epi32(r)), src, 4);
+			acc = _mm512_maskz_add_round_ps(ALL_LANES, acc, _mm512_maskz_mul_round_ps(ALL_LANES,
+				_mm512_loadu_ps(basis_t + r * n + s), g, _MM_FROUND_CUR_DIRECTION), _MM_FROUND_CUR_DIRECTION);
+		}
+		_mm512_storeu_ps(dst + s, acc);
+	}
+	curve_avx2(starts, basis_t, n, k, src, dst, s);
+}
+
+NURBS_TARGET("avx512f")
+void row_avx512(const float* w, int k, const float* src, int stride,
+	            int n, float* dst, int begin)
+{
+	int j = begin;
+	for ( ; j + 16 <= n; j += 16)
+	{
+		__m512 acc = _mm512_setzero_ps();
+		for (int r = 0; r < k; ++r) {
+			acc = _mm512_maskz_add_round_ps(ALL_LANES, acc, _mm512_maskz_mul_round_ps(ALL_LANES,
+				_mm512_set1_ps(w[r]), _mm512_loadu_ps(src + r * stride + j), _MM_FROUND_CUR_DIRECTION),
+				_MM_FROUND_CUR_DIRECTION);
+		}
+		_mm512_storeu_ps(dst + j, acc);
+	}
+	row_avx2(w, k, src, stride, n, dst, j);
+}
+
+nurbs::SimdLevel detect_cpu()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	const int max_leaf = info[0];
+
+	__cpuid(info, 1);
+	const bool sse2 = (info[3] & (1 << 26)) != 0;
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+	const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+
+	bool avx2 = false, avx512 = false;
+	if (max_leaf >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		avx2   = avx && (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+		avx512 = (xcr0 & 0xe6) == 0xe6 && (info[1] & (1 << 16)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+	const bool sse2   = __builtin_cpu_supports("sse2");
+	const bool avx2   = __builtin_cpu_supports("avx2");
+	const bool avx512 = __builtin_cpu_supports("avx512f");
+#endif
+
+	if (avx512) {
+		return nurbs::SimdLevel::AVX512;
+	} else if (avx2) {
+		return nurbs::SimdLevel::AVX2;
+	} else if (sse2) {
+		return nurbs::SimdLevel::SSE;
+	} else {
+		return nurbs::SimdLevel::Scalar;
+	}
+}
+
+#endif // NURBS_X86
+
+// never hand out a kernel the CPU can't run
+nurbs::SimdLevel clamp_level(nurbs::SimdLevel level)
+{
+	nurbs::SimdLevel max = nurbs::simd_detect();
+	return level > max ? max : level;
+}
+
+CurveKernel curve_kernel(nurbs::SimdLevel level)
+{
+	switch (clamp_level(level))
+	{
+#ifdef NURBS_X86
+	case nurbs::SimdLevel::SSE:
+		return curve_sse;
+	case nurbs::SimdLevel::AVX2:
+		return curve_avx2;
+	case nurbs::SimdLevel::AVX512:
+		return curve_avx512;
+#endif
+	default:
+		return curve_scalar;
+	}
+}
+
+RowKernel row_kernel(nurbs::SimdLevel level)
+{
+	switch (clamp_level(level))
+	{
+#ifdef NURBS_X86
+	case nurbs::SimdLevel::SSE:
+		return row_sse;
+	case nurbs::SimdLevel::AVX2:
+		return row_avx2;
+	case nurbs::SimdLevel::AVX512:
+		return row_avx512;
+#endif
+	default:
+		return row_scalar;
+	}
+}
+
+
+// surface from dim separate component nets, see batch_eval_surface
+void eval_surface(const nurbs::TessPlan& u_plan, const nurbs::TessPlan& w_plan,
+	              const float* const* src, float* const* dst, int dim, float* work,
+	              nurbs::SimdLevel level)
+{
+	auto curve = curve_kernel(level);
+	auto row = row_kernel(level);
+
+	const int k = u_plan.GetOrder();
+	const int l = w_plan.GetOrder();
+	const int mpts = w_plan.GetKey().npts;
+	const int nu = u_plan.GetSamples();
+	const int nw = w_plan.GetSamples();
+
+	for (int iu = 0; iu < nu; ++iu)
+	{
+		const float* nbasis = u_plan.GetBasis() + iu * k;
+		const int offset = u_plan.GetStarts()[iu] * mpts;
+		for (int c = 0; c < dim; ++c)
+		{
+			// collapse the k contributing rows into one row of w control points
+			float* col = work + c * mpts;
+			row(nbasis, k, src[c] + offset, mpts, mpts, col, 0);
+			curve(w_plan.GetStarts(), w_plan.GetBasisT(), nw, l, col, dst[c] + iu * nw, 0);
+		}
+	}
+}
+
+// dst[c][i] /= h[i], aitn::project_homogeneous on the coordinate planes
+void project(float* const* dst, int dim, const float* h, int n)
+{
+	for (int c = 0; c < dim; ++c)
+	{
+		float* d = dst[c];
+		for (int i = 0; i < n; ++i) {
+			aitn::project_homogeneous(&d[i], h[i], 1, &d[i]);
+		}
+	}
+}
+
+}
+
+namespace nurbs
+{
+
+SimdLevel simd_detect()
+{
+#ifdef NURBS_X86
+	static const SimdLevel level = detect_cpu();
+	return level;
+#else
+	return SimdLevel::Scalar;
+#endif
+}
+
+const char* simd_name(SimdLevel level)
+{
+	switch (level)
+	{
+	case SimdLevel::SSE:
+		return "sse";
+	case SimdLevel::AVX2:
+		return "avx2";
+	case SimdLevel::AVX512:
+		return "avx512";
+	default:
+		return "scalar";
+	}
+}
+
+void batch_eval(const TessPlan& plan, const float* x, const float* y, const float* z,
+	            float* out_x, float* out_y, float* out_z, SimdLevel level)
+{
+	auto kernel = curve_kernel(level);
+
+	const int n = plan.GetSamples();
+	const int k = plan.GetOrder();
+	kernel(plan.GetStarts(), plan.GetBasisT(), n, k, x, out_x, 0);
+	kernel(plan.GetStarts(), plan.GetBasisT(), n, k, y, out_y, 0);
+	if (z && out_z) {
+		kernel(plan.GetStarts(), plan.GetBasisT(), n, k, z, out_z, 0);
+	}
+}
+
+void batch_eval_surface(const TessPlan& u_plan, const TessPlan& w_plan,
+	                    const float* x, const float* y, const float* z,
+	                    float* out_x, float* out_y, float* out_z, float* work,
+	                    SimdLevel level)
+{
+	const float* src[3] = { x, y, z };
+	float* dst[3] = { out_x, out_y, out_z };
+	const int dim = z && out_z ? 3 : 2;
+	eval_surface(u_plan, w_plan, src, dst, dim, work, level);
+}
+
+void batch_eval_rational(const TessPlan& plan, const float* x, const float* y, const float* z,
+	                     const float* h, float* out_x, float* out_y, float* out_z, float* work,
+	                     SimdLevel level)
+{
+	auto kernel = curve_kernel(level);
+
+	const int npts = plan.GetKey().npts;
+	const int n = plan.GetSamples();
+	const int k = plan.GetOrder();
+
+	const float* src[3] = { x, y, z };
+	float* dst[3] = { out_x, out_y, out_z };
+	const int dim = z && out_z ? 3 : 2;
+
+	// (hx, hy, hz) through the non-rational kernel, h itself as the 4th component
+	float* hsum = work + dim * npts;
+	for (int c = 0; c < dim; ++c)
+	{
+		float* hc = work + c * npts;
+		for (int i = 0; i < npts; ++i) {
+			hc[i] = src[c][i] * h[i];
+		}
+		kernel(plan.GetStarts(), plan.GetBasisT(), n, k, hc, dst[c], 0);
+	}
+	kernel(plan.GetStarts(), plan.GetBasisT(), n, k, h, hsum, 0);
+	project(dst, dim, hsum, n);
+}
+
+void batch_eval_surface_rational(const TessPlan& u_plan, const TessPlan& w_plan,
+	                             const float* x, const float* y, const float* z, const float* h,
+	                             float* out_x, float* out_y, float* out_z, float* work,
+	                             SimdLevel level)
+{
+	const int npts = u_plan.GetKey().npts;
+	const int mpts = w_plan.GetKey().npts;
+	const int size = npts * mpts;
+
+	const float* src[4] = { x, y, z, h };
+	const int dim = z && out_z ? 3 : 2;
+
+	// work: homogeneous net, the denominators, then eval_surface's rows
+	const float* hsrc[4];
+	for (int c = 0; c < dim; ++c)
+	{
+		float* hc = work + c * size;
+		for (int i = 0; i < size; ++i) {
+			hc[i] = src[c][i] * h[i];
+		}
+		hsrc[c] = hc;
+	}
+	hsrc[dim] = h;
+
+	float* hsum = work + dim * size;
+	float* dst[4] = { out_x, out_y, out_z, nullptr };
+	dst[dim] = hsum;
+	eval_surface(u_plan, w_plan, hsrc, dst, dim + 1, hsum + u_plan.GetSamples() * w_plan.GetSamples(), level);
+	project(dst, dim, hsum, u_plan.GetSamples() * w_plan.GetSamples());
+}
+
+}
@@ -0,0 +1,106 @@
+#include "../include/nurbs/SurfaceTess.h"
+#include "../include/nurbs/TessPlan.h"
+#include "../include/nurbs/ThreadPool.h"
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+namespace
+{
+
+// everything a tile needs, computed once per patch before the tiles run
+struct Prepared
+{
+	const nurbs::SurfacePatch* patch;
+
+	std::shared_ptr<const nurbs::TessPlan> u_plan, w_plan;
+};
+
+struct Tile
+{
+	int patch;
+	int u_begin, u_end;
+	int w_begin, w_end;
+};
+
+void prepare(const nurbs::SurfacePatch& patch, Prepared& prep)
+{
+	prep.patch = &patch;
+
+	// A Bezier net of n points is a B-spline of order n on the open knots
+	// (0, ..., 0, 1, ..., 1), sampled with the same stepping as
+	// aitn::bezsurf, so both come from the cached plans and a repeated
+	// call allocates nothing.
+	const bool bezier = patch.type == nurbs::SurfaceType::Bezier;
+	const int k = bezier ? patch.npts : patch.order_u;
+	const int l = bezier ? patch.mpts : patch.order_w;
+	auto& cache = nurbs::TessPlanCache::Instance();
+	prep.u_plan = cache.Fetch({ k, patch.npts, patch.p1, nurbs::KnotType::Open });
+	prep.w_plan = cache.Fetch({ l, patch.mpts, patch.p2, nurbs::KnotType::Open });
+}
+
+void eval_tile(const Prepared& prep, const Tile& tile)
+{
+	const nurbs::SurfacePatch& patch = *prep.patch;
+	if (patch.type == nurbs::SurfaceType::RBSpline)
+	{
+		nurbs::TessPlan::EvalSurfaceRational(*prep.u_plan, *prep.w_plan, patch.net, patch.row_stride,
+			tile.u_begin, tile.u_end, tile.w_begin, tile.w_end, patch.out);
+	}
+	else if (patch.weights)
+	{
+		nurbs::TessPlan::EvalSurfaceRational(*prep.u_plan, *prep.w_plan, patch.net, patch.weights,
+			patch.row_stride, tile.u_begin, tile.u_end, tile.w_begin, tile.w_end, patch.out);
+	}
+	else
+	{
+		nurbs::TessPlan::EvalSurface(*prep.u_plan, *prep.w_plan, patch.net, patch.row_stride,
+			tile.u_begin, tile.u_end, tile.w_begin, tile.w_end, patch.out);
+	}
+}
+
+}
+
+namespace nurbs
+{
+
+void tessellate(const SurfacePatch& patch)
+{
+	if (patch.p1 < 2 || patch.p2 < 2) {
+		return;
+	}
+
+	Prepared prep;
+	prepare(patch, prep);
+	eval_tile(prep, { 0, 0, patch.p1, 0, patch.p2 });
+}
+
+void tessellate(const SurfacePatch* patches, int count, ThreadPool& pool, int tile)
+{
+	if (tile < 1) {
+		tile = 1;
+	}
+
+	std::vector<Prepared> preps(count);
+	std::vector<Tile> tiles;
+	for (int i = 0; i < count; ++i)
+	{
+		auto& patch = patches[i];
+		if (patch.p1 < 2 || patch.p2 < 2) {
+			continue;
+		}
+		prepare(patch, preps[i]);
+		for (int u = 0; u < patch.p1; u += tile) {
+			for (int w = 0; w < patch.p2; w += tile) {
+				tiles.push_back({ i, u, std::min(u + tile, patch.p1), w, std::min(w + tile, patch.p2) });
+			}
+		}
+	}
+
+	pool.ParallelFor(static_cast<int>(tiles.size()), [&](int i) {
+		eval_tile(preps[tiles[i].patch], tiles[i]);
+	});
+}
+
+}
@@ -0,0 +1,279 @@
+#include "../include/nurbs/TessPlan.h"
+
+#include "../external/aitn/bsp_util.h"
+#include "../external/aitn/rbsp_util.h"
+
+#include <functional>
+
+namespace
+{
+
+// b_comp floats per net point in b, h_comp per weight in h
+void eval_surface_rational(const nurbs::TessPlan& u_plan, const nurbs::TessPlan& w_plan,
+	                       const float* b, int b_comp, const float* h, int h_comp,
+	                       int row_stride, int u_begin, int u_end, int w_begin, int w_end,
+	                       float* q)
+{
+	const int k = u_plan.GetOrder();
+	const int l = w_plan.GetOrder();
+	const int nw = w_plan.GetSamples();
+	for (int iu = u_begin; iu < u_end; ++iu)
+	{
+		const float* nbasis = u_plan.GetBasis() + iu * k;
+		const int ustart = u_plan.GetStarts()[iu];
+		float* dst = q + 3 * (iu * nw + w_begin);
+		for (int iw = w_begin; iw < w_end; ++iw)
+		{
+			const float* mbasis = w_plan.GetBasis() + iw * l;
+			const int wstart = w_plan.GetStarts()[iw];
+
+			float v[3] = { 0, 0, 0 }, sum = 0;
+			for (int i = 0; i < k; ++i)
+			{
+				const int first = row_stride * (ustart + i) + wstart;
+				const float* row = b + b_comp * first;
+				const float* row_h = h + h_comp * first;
+				for (int j = 0; j < l; ++j)
+				{
+					float pbasis = row_h[h_comp * j] * nbasis[i] * mbasis[j];
+					v[0] += row[b_comp * j]     * pbasis;
+					v[1] += row[b_comp * j + 1] * pbasis;
+					v[2] += row[b_comp * j + 2] * pbasis;
+					sum += pbasis;
+				}
+			}
+			aitn::project_homogeneous(v, sum, 3, dst);
+			dst += 3;
+		}
+	}
+}
+
+}
+
+namespace nurbs
+{
+
+size_t TessPlan::KeyHash::operator () (const Key& key) const
+{
+	size_t h = std::hash<int>()(key.order);
+	h = h * 31 + std::hash<int>()(key.npts);
+	h = h * 31 + std::hash<int>()(key.samples);
+	h = h * 31 + static_cast<size_t>(key.knot);
+	return h;
+}
+
+TessPlan::TessPlan(const Key& key)
+	: m_key(key)
+{
+	const int k = key.order;
+	const int npts = key.npts;
+	const int p1 = key.samples;
+
+	std::vector<int> x(aitn::bsp_knot_size(npts, k));
+	std::vector<float> work(aitn::bsp_work_size(npts, k));
+	float* left  = work.data() + k;
+	float* right = work.data() + 2 * k;
+
+	// same parameter stepping as aitn::bspline and aitn::bsplineu
+	float t, t_max, step;
+	if (key.knot == KnotType::Open)
+	{
+		aitn::knot(npts, k, x.data());
+		t_max = static_cast<float>(x[npts + k - 1]);
+		t = 0;
+		step = t_max / static_cast<float>(p1 - 1);
+	}
+	else
+	{
+		aitn::knotu(npts, k, x.data());
+		t_max = static_cast<float>(npts);
+		t = static_cast<float>(k - 1);
+		step = static_cast<float>(npts - (k - 1)) / static_cast<float>(p1 - 1);
+	}
+
+	m_starts.resize(p1);
+	m_basis.resize(p1 * k);
+	for (int i = 0; i < p1; ++i)
+	{
+		if (t_max - t < 5e-6) {
+			t = t_max;
+		}
+		int span = aitn::find_span(k, t, npts, x.data());
+		m_starts[i] = span - k + 1;
+		aitn::basis_span(k, t, span, x.data(), &m_basis[i * k], left, right);
+		t += step;
+	}
+
+	m_basis_t.resize(p1 * k);
+	for (int i = 0; i < p1; ++i) {
+		for (int r = 0; r < k; ++r) {
+			m_basis_t[r * p1 + i] = m_basis[i * k + r];
+		}
+	}
+}
+
+void TessPlan::Eval(const float* b, int dim, float* p) const
+{
+	const int k = m_key.order;
+	for (int i = 0, n = m_key.samples; i < n; ++i)
+	{
+		const float* nbasis = &m_basis[i * k];
+		const float* src = b + m_starts[i] * dim;
+		for (int j = 0; j < dim; ++j)
+		{
+			float sum = 0;
+			for (int r = 0; r < k; ++r) {
+				sum += nbasis[r] * src[r * dim + j];
+			}
+			p[j] = sum;
+		}
+		p += dim;
+	}
+}
+
+void TessPlan::EvalRational(const float* b, const float* h, int dim, float* p) const
+{
+	const int k = m_key.order;
+	for (int i = 0, n = m_key.samples; i < n; ++i)
+	{
+		const float* nbasis = &m_basis[i * k];
+		const float* src = b + m_starts[i] * dim;
+		const float* src_h = h + m_starts[i];
+
+		for (int j = 0; j < dim; ++j) {
+			p[j] = 0;
+		}
+		float sum = 0;
+		for (int r = 0; r < k; ++r)
+		{
+			const float hbasis = nbasis[r] * src_h[r];
+			for (int j = 0; j < dim; ++j) {
+				p[j] += hbasis * src[r * dim + j];
+			}
+			sum += hbasis;
+		}
+		aitn::project_homogeneous(p, sum, dim, p);
+		p += dim;
+	}
+}
+
+void TessPlan::EvalSurface(const TessPlan& u_plan, const TessPlan& w_plan,
+	                       const float* b, int row_stride, float* q)
+{
+	EvalSurface(u_plan, w_plan, b, row_stride, 0, u_plan.m_key.samples,
+		0, w_plan.m_key.samples, q);
+}
+
+void TessPlan::EvalSurface(const TessPlan& u_plan, const TessPlan& w_plan,
+	                       const float* b, int row_stride, int u_begin, int u_end,
+	                       int w_begin, int w_end, float* q)
+{
+	const int k = u_plan.m_key.order;
+	const int l = w_plan.m_key.order;
+	const int nw = w_plan.m_key.samples;
+	for (int iu = u_begin; iu < u_end; ++iu)
+	{
+		const float* nbasis = &u_plan.m_basis[iu * k];
+		const int ustart = u_plan.m_starts[iu];
+		float* dst = q + 3 * (iu * nw + w_begin);
+		for (int iw = w_begin; iw < w_end; ++iw)
+		{
+			const float* mbasis = &w_plan.m_basis[iw * l];
+			const int wstart = w_plan.m_starts[iw];
+			float x = 0, y = 0, z = 0;
+			for (int i = 0; i < k; ++i)
+			{
+				const float* row = b + 3 * (row_stride * (ustart + i) + wstart);
+				for (int j = 0; j < l; ++j)
+				{
+					float pbasis = nbasis[i] * mbasis[j];
+					x += row[3 * j]     * pbasis;
+					y += row[3 * j + 1] * pbasis;
+					z += row[3 * j + 2] * pbasis;
+				}
+			}
+			dst[0] = x;
+			dst[1] = y;
+			dst[2] = z;
+			dst += 3;
+		}
+	}
+}
+
+void TessPlan::EvalSurfaceRational(const TessPlan& u_plan, const TessPlan& w_plan,
+	                               const float* b, int row_stride, float* q)
+{
+	EvalSurfaceRational(u_plan, w_plan, b, row_stride, 0, u_plan.m_key.samples,
+		0, w_plan.m_key.samples, q);
+}
+
+void TessPlan::EvalSurfaceRational(const TessPlan& u_plan, const TessPlan& w_plan,
+	                               const float* b, int row_stride, int u_begin, int u_end,
+	                               int w_begin, int w_end, float* q)
+{
+	eval_surface_rational(u_plan, w_plan, b, 4, b + 3, 4, row_stride,
+		u_begin, u_end, w_begin, w_end, q);
+}
+
+void TessPlan::EvalSurfaceRational(const TessPlan& u_plan, const TessPlan& w_plan,
+	                               const float* b, const float* h, int row_stride,
+	                               int u_begin, int u_end, int w_begin, int w_end, float* q)
+{
+	eval_surface_rational(u_plan, w_plan, b, 3, h, 1, row_stride,
+		u_begin, u_end, w_begin, w_end, q);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// class TessPlanCache
+//////////////////////////////////////////////////////////////////////////
+
+TessPlanCache::TessPlanCache(size_t capacity)
+	: m_capacity(capacity)
+{
+}
+
+std::shared_ptr<const TessPlan> TessPlanCache::Fetch(const TessPlan::Key& key)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto itr = m_map.find(key);
+		if (itr != m_map.end()) {
+			m_lru.splice(m_lru.begin(), m_lru, itr->second);
+			return itr->second->second;
+		}
+	}
+
+	// build outside the lock, other threads keep hitting the cache
+	auto plan = std::make_shared<const TessPlan>(key);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto itr = m_map.find(key);
+	if (itr != m_map.end()) {
+		m_lru.splice(m_lru.begin(), m_lru, itr->second);
+		return itr->second->second;
+	}
+
+	m_lru.emplace_front(key, plan);
+	m_map.insert({ key, m_lru.begin() });
+	while (m_lru.size() > m_capacity)
+	{
+		m_map.erase(m_lru.back().first);
+		m_lru.pop_back();
+	}
+	return plan;
+}
+
+void TessPlanCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_map.clear();
+	m_lru.clear();
+}
+
+TessPlanCache& TessPlanCache::Instance()
+{
+	static TessPlanCache cache;
+	return cache;
+}
+
+}
@@ -0,0 +1,149 @@
+#include "../include/nurbs/ThreadPool.h"
+
+namespace nurbs
+{
+
+ThreadPool::ThreadPool(int threads)
+	: m_generation(0)
+	, m_quit(false)
+	, m_func(nullptr)
+	, m_pending(0)
+{
+	if (threads <= 0) {
+		threads = static_cast<int>(std::thread::hardware_concurrency());
+	}
+	if (threads <= 0) {
+		threads = 1;
+	}
+
+	for (int i = 0; i < threads; ++i) {
+		m_queues.push_back(std::make_unique<Queue>());
+	}
+	for (int i = 0; i < threads - 1; ++i) {
+		m_threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_wake_cv.notify_all();
+	for (auto& t : m_threads) {
+		t.join();
+	}
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& func)
+{
+	if (count <= 0) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> run_lock(m_run_mutex);
+
+	const int caller = GetThreadNum() - 1;
+	if (caller == 0)
+	{
+		for (int i = 0; i < count; ++i) {
+			func(i);
+		}
+		return;
+	}
+
+	m_func = &func;
+	m_pending = count;
+
+	// contiguous blocks keep neighbouring tiles on one thread
+	const int num = GetThreadNum();
+	for (int q = 0; q < num; ++q)
+	{
+		const int begin = count * q / num;
+		const int end = count * (q + 1) / num;
+		std::lock_guard<std::mutex> lock(m_queues[q]->mutex);
+		for (int i = end - 1; i >= begin; --i) {
+			m_queues[q]->items.push_back(i);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_generation;
+	}
+	m_wake_cv.notify_all();
+
+	Work(caller);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done_cv.wait(lock, [this] { return m_pending == 0; });
+	m_func = nullptr;
+}
+
+ThreadPool& ThreadPool::Instance()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+bool ThreadPool::Pop(int id, int& item)
+{
+	auto& q = *m_queues[id];
+	std::lock_guard<std::mutex> lock(q.mutex);
+	if (q.items.empty()) {
+		return false;
+	}
+	item = q.items.back();
+	q.items.pop_back();
+	return true;
+}
+
+bool ThreadPool::Steal(int id, int& item)
+{
+	const int num = GetThreadNum();
+	for (int i = 1; i < num; ++i)
+	{
+		auto& q = *m_queues[(id + i) % num];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if (!q.items.empty()) {
+			item = q.items.front();
+			q.items.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::Work(int id)
+{
+	int item;
+	while (Pop(id, item) || Steal(id, item))
+	{
+		(*m_func)(item);
+		if (--m_pending == 0)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_done_cv.notify_all();
+		}
+	}
+}
+
+void ThreadPool::WorkerLoop(int id)
+{
+	unsigned int generation = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake_cv.wait(lock, [&] { return m_quit || m_generation != generation; });
+			if (m_quit) {
+				return;
+			}
+			generation = m_generation;
+		}
+		Work(id);
+	}
+}
+
+}
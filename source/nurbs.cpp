@@ -1,42 +1,49 @@
 #include "../include/nurbs/nurbs.h"
+#include "../include/nurbs/TessPlan.h"
+#include "../include/nurbs/SurfaceTess.h"
 #include "../external/aitn/bezier.h"
-#include "../external/aitn/bspline.h"
-#include "../external/aitn/rbspline.h"
-#include "../external/aitn/bezsurf.h"
-#include "../external/aitn/bspsurf.h"
-#include "../external/aitn/rbspsurf.h"
+#include "../external/aitn/rbsp_util.h"
 
 #include <memory>
 
 namespace
 {
 
-auto dump_vec2 = [](const std::vector<sm::vec2>& array) -> std::vector<float>
-{
-	std::vector<float> ret;
-	ret.resize(array.size() * 2);
-	for (int i = 0, n = array.size(); i < n; ++i) 
-	{
-		auto& p = array[i];
-		ret[i * 2]     = p.x;
-		ret[i * 2 + 1] = p.y;
-	}
-	return ret;
-};
+const int MAX_COMP = 3;
 
-auto dump_vec3 = [](const std::vector<sm::vec2>& array) -> std::vector<float>
+void eval_plan(const nurbs::TessPlan& plan, const nurbs::PointView<const float>& ctl_pts,
+	           const float* weights, const nurbs::PointView<float>& polyline)
 {
-	std::vector<float> ret;
-	ret.resize(array.size() * 3);
-	for (int i = 0, n = array.size(); i < n; ++i) 
+	const int k = plan.GetOrder();
+	const int dim = ctl_pts.dim < polyline.dim ? ctl_pts.dim : polyline.dim;
+	const int* starts = plan.GetStarts();
+	const float* basis = plan.GetBasis();
+	for (int i = 0, n = polyline.count; i < n; ++i)
 	{
-		auto& p = array[i];
-		ret[i * 3]     = p.x;
-		ret[i * 3 + 1] = p.y;
-		ret[i * 3 + 2] = 0;
+		const float* nbasis = basis + i * k;
+		const int start = starts[i];
+
+		float v[MAX_COMP] = { 0 };
+		float sum = 0;
+		for (int r = 0; r < k; ++r)
+		{
+			const float hbasis = weights ? nbasis[r] * weights[start + r] : nbasis[r];
+			for (int c = 0; c < dim; ++c) {
+				v[c] += hbasis * ctl_pts.At(start + r, c);
+			}
+			sum += hbasis;
+		}
+		if (weights) {
+			aitn::project_homogeneous(v, sum, dim, v);
+		}
+		for (int c = 0; c < dim; ++c) {
+			polyline.At(i, c) = v[c];
+		}
+		for (int c = dim; c < polyline.dim; ++c) {
+			polyline.At(i, c) = 0;
+		}
 	}
-	return ret;
-};
+}
 
 }
 
@@ -49,15 +56,8 @@ void bezier(const std::vector<sm::vec2>& ctl_pts, std::vector<sm::vec2>& polylin
 		return;
 	}
 
-	auto b = dump_vec2(ctl_pts);
-	auto p = dump_vec2(polyline);
-	aitn::bezier<float, 2>(ctl_pts.size(), b.data(), polyline.size(), p.data());
-
-	for (int i = 0, n = polyline.size(); i < n; ++i) 
-	{
-		polyline[i].x = p[i * 2];
-		polyline[i].y = p[i * 2 + 1];
-	}
+	bezier(make_view(ctl_pts.data(), ctl_pts.size()),
+		make_view(polyline.data(), polyline.size()));
 }
 
 void bspline(const std::vector<sm::vec2>& ctl_pts, int order,
@@ -67,16 +67,8 @@ void bspline(const std::vector<sm::vec2>& ctl_pts, int order,
 		return;
 	}
 
-	auto b = dump_vec3(ctl_pts);
-	auto p = dump_vec3(polyline);
-	aitn::bspline(ctl_pts.size(), order, polyline.size(), b.data(), p.data());
-//	aitn::bsplineu(ctl_pts.size(), order, polyline.size(), b.data(), p.data());
-
-	for (int i = 0, n = polyline.size(); i < n; ++i)
-	{
-		polyline[i].x = p[i * 3];
-		polyline[i].y = p[i * 3 + 1];
-	}
+	bspline(make_view(ctl_pts.data(), ctl_pts.size()), order,
+		make_view(polyline.data(), polyline.size()));
 }
 
 void rbspline(const std::vector<sm::vec2>& ctl_pts, int order,
@@ -86,287 +78,99 @@ void rbspline(const std::vector<sm::vec2>& ctl_pts, int order,
 		return;
 	}
 
-	std::vector<float> h(ctl_pts.size(), 1.0f);
+	rbspline(make_view(ctl_pts.data(), ctl_pts.size()), nullptr, order,
+		make_view(polyline.data(), polyline.size()));
+}
+
+void bezier(const PointView<const float>& ctl_pts, const PointView<float>& polyline)
+{
+	if (ctl_pts.count == 0 || polyline.count < 2) {
+		return;
+	}
 
-	auto b = dump_vec3(ctl_pts);
-	auto p = dump_vec3(polyline);
-	aitn::rbspline(ctl_pts.size(), order, polyline.size(), b.data(), h.data(), p.data());
-//	aitn::rbsplineu(ctl_pts.size(), order, polyline.size(), b.data(), h.data(), p.data());
+	const int n = ctl_pts.count - 1;
+	const int dim = ctl_pts.dim < polyline.dim ? ctl_pts.dim : polyline.dim;
+	auto ctl = [&](int i, int c) -> float {
+		return c < dim ? ctl_pts.At(i, c) : 0.0f;
+	};
 
-	for (int i = 0, n = polyline.size(); i < n; ++i)
+	// same parameter stepping as aitn::bezier
+	float t = 0;
+	float step = 1.0f / static_cast<float>(polyline.count - 1);
+	for (int i = 0; i < polyline.count; ++i)
 	{
-		polyline[i].x = p[i * 3];
-		polyline[i].y = p[i * 3 + 1];
+		if (1.0f - t < 5e-6) {
+			t = 1.0f;
+		}
+		float p[MAX_COMP];
+		aitn::horner<float, MAX_COMP>(n, t, ctl, p);
+		for (int c = 0; c < polyline.dim; ++c) {
+			polyline.At(i, c) = p[c];
+		}
+		t += step;
 	}
 }
 
-void bezsurf(const sm::vec3* ctl_pts, int npts, int mpts,
-	         int p1, int p2, std::vector<sm::vec3>& surface)
+void bspline(const PointView<const float>& ctl_pts, int order, const PointView<float>& polyline)
 {
-	float b[61];
-	float q[301];
-
-	memset(b, 0, sizeof(b));
-	memset(q, 0, sizeof(q));
-
-	b[1] = -15.;
-	b[2] = 0.;
-	b[3] = 15.;
-	b[4] = -15.;
-	b[5] = 5.;
-	b[6] = 5.;
-	b[7] = -15.;
-	b[8] = 5.;
-	b[9] = -5.;
-	b[10] = -15.;
-	b[11] = 0.;
-	b[12] = -15.;
-
-	b[13] = -5.;
-	b[14] = 5.;
-	b[15] = 15.;
-	b[16] = -5.;
-	b[17] = 5.;
-	b[18] = 5.;
-	b[19] = -5.;
-	b[20] = 5.;
-	b[21] = -5.;
-	b[22] = -5.;
-	b[23] = 5.;
-	b[24] = -15.;
-
-	b[25] = 5.;
-	b[26] = 5.;
-	b[27] = 15.;
-	b[28] = 5.;
-	b[29] = 5.;
-	b[30] = 5.;
-	b[31] = 5.;
-	b[32] = 5.;
-	b[33] = -5.;
-	b[34] = 5.;
-	b[35] = 5.;
-	b[36] = -15.;
+	if (order < 2 || ctl_pts.count < order || polyline.count < 2) {
+		return;
+	}
 
-	b[37] = 15.;
-	b[38] = 0.;
-	b[39] = 15.;
-	b[40] = 15.;
-	b[41] = 5.;
-	b[42] = 5.;
-	b[43] = 15.;
-	b[44] = 5.;
-	b[45] = -5.;
-	b[46] = 15.;
-	b[47] = 0.;
-	b[48] = -15.;
+	auto plan = TessPlanCache::Instance().Fetch({ order, ctl_pts.count, polyline.count, KnotType::Open });
+	eval_plan(*plan, ctl_pts, nullptr, polyline);
+}
 
-	for (int i = 0; i < 48; ++i) {
-		b[i] = b[i + 1] * 0.01f;;
+void rbspline(const PointView<const float>& ctl_pts, const float* weights,
+	          int order, const PointView<float>& polyline)
+{
+	if (order < 2 || ctl_pts.count < order || polyline.count < 2) {
+		return;
 	}
 
-	int n = npts - 1;
-	int m = mpts - 1;
-	//surface.resize(n * p1 * m * p2);
-	//aitn::bezsurf(const_cast<float*>(ctl_pts[0].xyz), n, m, 
-	//	p1, p2, surface[0].xyz);
+	auto plan = TessPlanCache::Instance().Fetch({ order, ctl_pts.count, polyline.count, KnotType::Open });
+	eval_plan(*plan, ctl_pts, weights, polyline);
+}
 
-	aitn::bezsurf(b, n, m, p1, p2, q);
+void bezsurf(const sm::vec3* ctl_pts, int npts, int mpts,
+	         int p1, int p2, std::vector<sm::vec3>& surface)
+{
+	if (!ctl_pts || npts < 1 || mpts < 1 || p1 < 2 || p2 < 2) {
+		return;
+	}
 
 	surface.resize(p1 * p2);
-
-	int ptr = 0;
-	for (int i = 0, n = p1 * p2; i < n; ++i) 
-	{
-		surface[i].x = q[ptr++];
-		surface[i].y = q[ptr++];
-		surface[i].z = q[ptr++];
-	}
+	tessellate({ SurfaceType::Bezier, ctl_pts[0].xyz, npts, mpts, mpts, 0, 0, p1, p2, surface[0].xyz, nullptr });
 }
 
 void bspsurf(const sm::vec3* ctl_pts, int order_u, int order_v,
 	         int npts, int mpts, int p1, int p2, std::vector<sm::vec3>& surface)
 {
-	float b[61];
-	float q[301];
-
-	memset(b, 0, sizeof(b));
-	memset(q, 0, sizeof(q));
-
-	b[1] = -15.;
-	b[2] = 0.;
-	b[3] = 15.;
-	b[4] = -15.;
-	b[5] = 5.;
-	b[6] = 5.;
-	b[7] = -15.;
-	b[8] = 5.;
-	b[9] = -5.;
-	b[10] = -15.;
-	b[11] = 0.;
-	b[12] = -15.;
-
-	b[13] = -5.;
-	b[14] = 5.;
-	b[15] = 15.;
-	b[16] = -5.;
-	b[17] = 5.;
-	b[18] = 5.;
-	b[19] = -5.;
-	b[20] = 5.;
-	b[21] = -5.;
-	b[22] = -5.;
-	b[23] = 5.;
-	b[24] = -15.;
-
-	b[25] = 5.;
-	b[26] = 5.;
-	b[27] = 15.;
-	b[28] = 5.;
-	b[29] = 5.;
-	b[30] = 5.;
-	b[31] = 5.;
-	b[32] = 5.;
-	b[33] = -5.;
-	b[34] = 5.;
-	b[35] = 5.;
-	b[36] = -15.;
-
-	b[37] = 15.;
-	b[38] = 0.;
-	b[39] = 15.;
-	b[40] = 15.;
-	b[41] = 5.;
-	b[42] = 5.;
-	b[43] = 15.;
-	b[44] = 5.;
-	b[45] = -5.;
-	b[46] = 15.;
-	b[47] = 0.;
-	b[48] = -15.;
-
-	for (int i = 0; i < 48; ++i) {
-		b[i] = b[i + 1] * 0.01f;;
+	if (!ctl_pts || order_u < 2 || order_v < 2 || npts < order_u || mpts < order_v || p1 < 2 || p2 < 2) {
+		return;
 	}
 
-	int n = npts - 1;
-	int m = mpts - 1;
-	//surface.resize(n * p1 * m * p2);
-	//aitn::bezsurf(const_cast<float*>(ctl_pts[0].xyz), n, m, 
-	//	p1, p2, surface[0].xyz);
-
-	aitn::bsplsurf(b, order_u, order_v, n, m, p1, p2, q);
-	//aitn::bspsurfu(b, order_u, order_v, n, m, p1, p2, q);
-
 	surface.resize(p1 * p2);
-
-	int ptr = 0;
-	for (int i = 0, n = p1 * p2; i < n; ++i) 
-	{
-		surface[i].x = q[ptr++];
-		surface[i].y = q[ptr++];
-		surface[i].z = q[ptr++];
-	}
+	tessellate({ SurfaceType::BSpline, ctl_pts[0].xyz, npts, mpts, mpts, order_u, order_v, p1, p2, surface[0].xyz, nullptr });
 }
 
 void rbspsurf(const sm::vec3* ctl_pts, int order_u, int order_v,
 	          int npts, int mpts, int p1, int p2, std::vector<sm::vec3>& surface)
 {
-	float b[61];
-	float q[301];
-
-	memset(b, 0, sizeof(b));
-	memset(q, 0, sizeof(q));
-
-	b[1] = -15.;
-	b[2] = 0.;
-	b[3] = 15.;
-	b[4] = 1;
-	b[5] = -15.;
-	b[6] = 5.;
-	b[7] = 5.;
-	b[8] = 1;
-	b[9] = -15.;
-	b[10] = 5.;
-	b[11] = -5.;
-	b[12] = 1;
-	b[13] = -15.;
-	b[14] = 0.;
-	b[15] = -15.;
-	b[16] = 1;
-
-	b[17] = -5.;
-	b[18] = 5.;
-	b[19] = 15.;
-	b[20] = 1;
-	b[21] = -5.;
-	b[22] = 10.;
-	b[23] = 5.;
-	b[24] = 1;
-	b[25] = -5.;
-	b[26] = 10.;
-	b[27] = -5.;
-	b[28] = 1;
-	b[29] = -5.;
-	b[30] = 5.;
-	b[31] = -15.;
-	b[32] = 1;
-
-	b[33] = 5.;
-	b[34] = 5.;
-	b[35] = 15.;
-	b[36] = 1;
-	b[37] = 5.;
-	b[38] = 10.;
-	b[39] = 5.;
-	b[40] = 1;
-	b[41] = 5.;
-	b[42] = 10.;
-	b[43] = -5.;
-	b[44] = 1;
-	b[45] = 5.;
-	b[46] = 0.;
-	b[47] = -15.;
-	b[48] = 1;
-
-	b[49] = 15.;
-	b[50] = 0.;
-	b[51] = 15.;
-	b[52] = 1;
-	b[53] = 15.;
-	b[54] = 5.;
-	b[55] = 5.;
-	b[56] = 1;
-	b[57] = 15.;
-	b[58] = 5.;
-	b[59] = -5.;
-	b[60] = 1;
-	b[61] = 15.;
-	b[62] = 0.;
-	b[63] = -15.;
-	b[64] = 1;
+	rbspsurf(ctl_pts, nullptr, order_u, order_v, npts, mpts, p1, p2, surface);
+}
 
-	for (int i = 0; i < 64; ++i) {
-		b[i] = b[i + 1] * 0.01f;;
+void rbspsurf(const sm::vec3* ctl_pts, const float* weights, int order_u, int order_v,
+	          int npts, int mpts, int p1, int p2, std::vector<sm::vec3>& surface)
+{
+	if (!ctl_pts || order_u < 2 || order_v < 2 || npts < order_u || mpts < order_v || p1 < 2 || p2 < 2) {
+		return;
 	}
 
-	int n = npts - 1;
-	int m = mpts - 1;
-	//surface.resize(n * p1 * m * p2);
-	//aitn::bezsurf(const_cast<float*>(ctl_pts[0].xyz), n, m, 
-	//	p1, p2, surface[0].xyz);
-
-	aitn::rbspsurf(b, order_u, order_v, n, m, p1, p2, q);
-
+	// weights straight from the caller, no repacked (x, y, z, h) net
 	surface.resize(p1 * p2);
-
-	int ptr = 0;
-	for (int i = 0, n = p1 * p2; i < n; ++i) 
-	{
-		surface[i].x = q[ptr++];
-		surface[i].y = q[ptr++];
-		surface[i].z = q[ptr++];
-	}
+	tessellate({ SurfaceType::BSpline, ctl_pts[0].xyz, npts, mpts, mpts, order_u, order_v,
+		p1, p2, surface[0].xyz, weights });
 }
 
 }
\ No newline at end of file